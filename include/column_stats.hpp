@@ -0,0 +1,63 @@
+#pragma once
+
+#include "type_inference.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class CsvReader;
+
+struct ColumnStats {
+  uint64_t nulls = 0;     // empty cells
+  uint64_t max_width = 0; // longest unquoted value, in bytes
+  uint64_t distinct = 0;  // HyperLogLog estimate over non-empty values
+  // Least and greatest value as ordered by the column's type (numbers,
+  // dates by day, bools false first, text bytewise), unquoted; empty when
+  // no value parses as the type
+  std::string min, max;
+  // int64, float64 and currency: values that parse, their mean and sample
+  // standard deviation
+  uint64_t numbers = 0;
+  double mean = 0.0;
+  double stddev = 0.0;
+};
+
+// Registers per HyperLogLog sketch (2^12; about 1.6% standard error)
+constexpr size_t kDistinctRegisters = 1 << 12;
+
+// Statistics accumulated over the rows of one or more readers with the
+// same columns, such as the blocks of a stream. Each add is one pass over
+// the rows, split across threads whose partial results are then merged.
+class StatsTally {
+public:
+  explicit StatsTally(std::vector<ColumnSchema> schema);
+
+  // Only the listed rows when rows is given
+  void add(const CsvReader &reader, size_t threads = 1,
+           const std::vector<size_t> *rows = nullptr);
+  std::vector<ColumnStats> stats() const;
+
+private:
+  struct Column {
+    uint64_t nulls = 0;
+    uint64_t max_width = 0;
+    uint64_t numbers = 0;
+    double mean = 0.0;
+    double m2 = 0.0; // sum of squared deviations from the mean
+    bool has_range = false;
+    int64_t min_int = 0, max_int = 0; // int64, currency cents, days, bools
+    double min_float = 0.0, max_float = 0.0;
+    std::string min_text, max_text; // as written, quotes stripped
+    std::vector<uint8_t> registers = std::vector<uint8_t>(kDistinctRegisters);
+  };
+  std::vector<ColumnSchema> schema_;
+  std::vector<Column> columns_;
+};
+
+std::vector<ColumnStats>
+compute_column_stats(const CsvReader &reader,
+                     const std::vector<ColumnSchema> &schema,
+                     size_t threads = 1,
+                     const std::vector<size_t> *rows = nullptr);
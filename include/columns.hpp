@@ -0,0 +1,60 @@
+#pragma once
+
+#include "numeric.hpp"
+#include "type_inference.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class CsvReader;
+
+// One column of a parsed reader decoded into its schema type. Cells that
+// are empty or do not parse as the type are invalid and keep only their
+// text; an Enum cell always has a code, the empty string included.
+struct TypedColumn {
+  ColumnType type = ColumnType::Text;
+  std::vector<uint64_t> valid; // one bit per row
+  // Int64 values, Currency in cents, Date in days since 1970-01-01
+  std::vector<int64_t> ints;
+  std::vector<double> floats;  // Float64
+  std::vector<uint64_t> bools; // Bool, one bit per row
+  // Enum: a code per row into the sorted, unquoted dictionary, so codes
+  // order like the values
+  std::vector<uint32_t> codes;
+  std::vector<std::string> dictionary;
+
+  bool is_valid(size_t row) const {
+    return (valid[row >> 6] >> (row & 63)) & 1;
+  }
+  bool flag(size_t row) const { return (bools[row >> 6] >> (row & 63)) & 1; }
+
+  // A valid Int64, Float64, Currency (in whole units) or Date cell as the
+  // number filters compare
+  double number(size_t row) const;
+};
+
+// Single-value parsers behind TypedColumn, with the numeric ones in
+// numeric.hpp; false when s does not parse. Dates are YYYY-MM-DD or
+// MM/DD/YYYY (either separator), day first when the month cannot be one.
+bool parse_date_days(std::string_view s, int64_t &days);
+bool parse_bool(std::string_view s, bool &value);
+
+// Typed copies of the given columns of a parsed reader, decoded once on a
+// pool of threads for the paths that revisit a column (filters, sort).
+// Text columns are not copied.
+class ColumnStore {
+public:
+  ColumnStore(const CsvReader &reader, const std::vector<ColumnSchema> &schema,
+              const std::vector<size_t> &columns, size_t threads = 1);
+
+  // nullptr unless col was decoded
+  const TypedColumn *column(size_t col) const {
+    return col < columns_.size() ? columns_[col].get() : nullptr;
+  }
+
+private:
+  std::vector<std::unique_ptr<TypedColumn>> columns_;
+};
@@ -1,52 +1,279 @@
 #pragma once
 
 #include <cstddef>
-#include <span>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <string_view>
 #include <vector>
 
+enum class Compression;
+struct SeekIndex;
+
 std::string unquote(std::string_view field);
 
+// The field without its enclosing quotes, as a view: escaped quotes stay
+// doubled, which is enough wherever a value with a quote cannot match.
+inline std::string_view strip_quotes(std::string_view field) {
+  if (field.size() >= 2 && field.front() == '"' && field.back() == '"')
+    return field.substr(1, field.size() - 2);
+  return field;
+}
+
+// View over one parsed row. Field boundaries are stored as 32-bit end offsets
+// relative to the row start; each field starts one byte (the delimiter) after
+// the previous field's end unless that end carries kNoSeparator. Rows too long
+// for 32-bit offsets are stored as plain string_views instead.
+//
+// Rows from a lazy parse have no field offsets: fields are tokenized on
+// access, resuming from the last field read so a left-to-right walk over the
+// row stays linear.
+class RowView {
+  const char *base_ = nullptr;
+  const uint32_t *ends_ = nullptr;
+  const std::string_view *wide_ = nullptr;
+  size_t ncols_ = 0;
+  size_t len_ = 0;
+  char delim_ = ',';
+  mutable size_t cursor_field_ = 0;
+  mutable size_t cursor_pos_ = 0;
+
+  std::string_view lazy_field(size_t i) const;
+
+public:
+  static constexpr uint32_t kNoSeparator = 0x80000000u;
+  static constexpr uint32_t kOffsetMask = 0x7FFFFFFFu;
+
+  RowView(const char *base, const uint32_t *ends, size_t ncols)
+      : base_(base), ends_(ends), ncols_(ncols) {}
+  RowView(const std::string_view *wide, size_t ncols)
+      : wide_(wide), ncols_(ncols) {}
+  RowView(const char *base, size_t len, char delim, size_t ncols)
+      : base_(base), ncols_(ncols), len_(len), delim_(delim) {}
+
+  size_t size() const { return ncols_; }
+
+  std::string_view operator[](size_t i) const {
+    if (wide_)
+      return wide_[i];
+    if (!ends_)
+      return lazy_field(i);
+    size_t end = ends_[i] & kOffsetMask;
+    size_t start = 0;
+    if (i > 0) {
+      uint32_t prev = ends_[i - 1];
+      start = (prev & kOffsetMask) + ((prev & kNoSeparator) ? 0 : 1);
+      if (start > end)
+        start = end;
+    }
+    return {base_ + start, end - start};
+  }
+};
+
+// How input is brought into memory. The default is a plain private
+// mapping; every other option is a hint for cold caches and slow
+// filesystems such as NFS.
+struct IoOptions {
+  bool sequential = false;  // madvise(MADV_SEQUENTIAL) on the mapping
+  bool willneed = false;    // madvise(MADV_WILLNEED): start readahead now
+  bool populate = false;    // MAP_POPULATE: fault everything in up front
+  bool hugepages = false;   // madvise(MADV_HUGEPAGE) where supported
+  bool drop_behind = false; // MADV_DONTNEED pages behind the row count scan
+  bool pread = false; // pread into memory instead of mmap; streams read
+                      // ahead on a background thread
+};
+
+// Parses a comma-separated list of IoOptions names (sequential, willneed,
+// populate, hugepages, dropbehind, pread). Throws on an unknown name.
+IoOptions parse_io_options(std::string_view spec);
+
+// A lazy row index in the packed form a sidecar stores (see sidecar.hpp),
+// read in place. Per row, as unaligned 32-bit values: its length, and the
+// distance of its start from the previous row's start (row 0: from the
+// start of the file). kWide in either lists the row in wide, by row, with
+// its exact offset and length.
+struct PackedRows {
+  static constexpr uint32_t kWide = 0xFFFFFFFFu;
+  size_t count = 0;
+  const char *lengths = nullptr;  // uint32_t[count]
+  const char *advances = nullptr; // uint32_t[count]
+  size_t wide_count = 0;
+  const char *wide = nullptr; // {row, offset, length: uint64_t}[wide_count]
+};
+
 class CsvReader {
 private:
   int csv_fd = -1;
   size_t file_size_ = 0;
   void *addr = nullptr;
+  size_t map_skip_ = 0; // bytes mapped before data() for page alignment
+  IoOptions io_;
 
   std::string stdin_buf_; // buffer for stdin data
+  std::string peek_;      // bytes sniffed off a pipe, replayed first
+
+  // Stream mode: stdin_buf_ holds the header line, the complete rows of the
+  // current block (up to file_size_) and the partial row read after them
+  // (up to stream_filled_).
+  int stream_fd_ = -1;
+  size_t stream_filled_ = 0;
+  size_t stream_header_ = 0;
+  size_t stream_bytes_ = 0;
+  bool stream_eof_ = false;
+  struct ReadAhead;
+  std::unique_ptr<ReadAhead> read_ahead_;
+
+  // Compact field index: ~4 bytes per cell plus one pointer per row. In lazy
+  // mode ends/wide_fields hold one entry per row (the row length/span).
+  struct RowTable {
+    std::vector<const char *> starts;  // first byte of each row
+    std::vector<uint32_t> ends;        // flat row-major, stride = ncols_
+    std::vector<size_t> wide_rows;     // rows stored in wide_fields (sorted)
+    std::vector<std::string_view> wide_fields; // stride = ncols_
+
+    void clear();
+  };
+
+  static constexpr uint32_t kWideRow = 0xFFFFFFFFu;
 
   std::vector<std::string_view> headers_;
-  std::vector<std::string_view> fields_; // flat row-major, stride = ncols_
+  RowTable rows_;
   size_t ncols_ = 0;
   size_t parsed_rows_ = 0;
   size_t total_rows_ = 0;
+  size_t body_ = 0; // offset of the first row after the header
+  bool lazy_ = false;
+  char delim_ = ',';
 
-  void handle_mmap();
-  void read_stdin();
+  // Readers whose rows were appended after this one's (see append)
+  std::vector<std::unique_ptr<CsvReader>> shards_;
+  size_t shard_bytes_ = 0;
+  size_t seek_total_ = 0; // seek-tail mode: decompressed size of the file
+
+  // stratified_rows over this reader's own body only
+  std::vector<std::string_view> own_stratified_rows(size_t n,
+                                                    uint64_t seed) const;
+  void handle_mmap(int fd, size_t offset);
+  void read_file(int fd, size_t offset);
+  void advise(void *base, size_t len) const;
+  void start_stream(size_t block_bytes);
+  size_t stream_read(char *buf, size_t size);
+  void load_descriptor(int fd);
+  bool spill_pipe(int fd);
+  Compression detect_input(int fd);
+  void decompress_all(int fd, Compression c);
+  void load_tail(const SeekIndex &index, size_t tail_rows);
+  void read_all(int fd);
   size_t parse_header(char delimiter);
   void append_row_fields(const char *base, size_t start, size_t end,
-                         char delim);
-  size_t count_rows_from(size_t offset) const;
+                         char delim, std::vector<std::string_view> &out) const;
+  void store_row(RowTable &out, const char *row_start, size_t row_len,
+                 const std::vector<std::string_view> &fields) const;
+  size_t parse_rows(size_t begin, size_t limit, char delim,
+                    RowTable &out) const;
+  size_t index_rows(size_t begin, size_t limit, RowTable &out) const;
+  RowView wide_row(size_t i) const;
+  void reset();
+  void parse_parallel(size_t begin, char delim, size_t threads);
+  size_t count_rows_from(size_t offset, size_t threads,
+                         bool *eof_in_quotes = nullptr) const;
+  // Start of the first row after an arbitrary offset, quote state inferred
+  size_t row_after(size_t offset) const;
+  // Start of the body row an arbitrary offset falls in, found the same way
+  size_t row_containing(size_t offset) const;
+  // End of the row at start, without its line terminator
+  size_t row_end_at(size_t start) const;
 
 public:
   CsvReader() = delete;
-  CsvReader(const char *file_name);
+  CsvReader(const char *file_name, const IoOptions &io = {});
+  // Streams CSV from fd in blocks of about block_bytes (grown for rows that
+  // do not fit) and reads the first block. Throws if fd has no data.
+  CsvReader(int fd, size_t block_bytes, const IoOptions &io = {});
+  // Streams the file at file_name ("-" for stdin) as above.
+  CsvReader(const char *file_name, size_t block_bytes,
+            const IoOptions &io = {});
+  // Loads only the header line and at least tail_rows trailing rows of a
+  // compressed file, decompressing from the latest seek points of index
+  // that cover them. For parse_tail.
+  CsvReader(const char *file_name, const SeekIndex &index, size_t tail_rows);
   ~CsvReader();
   CsvReader(const CsvReader &) = delete;
   CsvReader &operator=(const CsvReader &) = delete;
 
-  void parse(char delimiter);
-  void parse_head(char delimiter, size_t max_rows);
+  // threads > 1 splits the body into byte ranges parsed concurrently; the
+  // resulting row order is identical to the serial parse.
+  void parse(char delimiter, size_t threads = 1);
+  // threads only splits the quote-aware count of the unparsed remainder.
+  void parse_head(char delimiter, size_t max_rows, size_t threads = 1);
+  // Tokenizes only the last max_rows rows, found by scanning backwards from
+  // the end of the data; total_rows() still counts the whole file.
+  void parse_tail(char delimiter, size_t max_rows, size_t threads = 1);
+  // Tokenizes up to max_rows rows found at pseudo-random byte offsets, each
+  // resynchronized to the next quote-correct row boundary, so the cost
+  // depends on max_rows rather than the file size. Small bodies are sampled
+  // exactly instead. Rows keep file order and total_rows() is the sample
+  // size. The same seed gives the same sample.
+  void parse_sample(char delimiter, size_t max_rows, uint64_t seed);
+  // Raw bytes of up to n non-blank rows spread over the whole body and
+  // every appended shard's, split between them by bytes: one per
+  // equal-sized byte stratum, from a seeded offset inside it resynchronized
+  // like parse_sample. Input order; independent of which rows are parsed,
+  // but needs the header.
+  std::vector<std::string_view> stratified_rows(size_t n,
+                                                uint64_t seed = 0) const;
+  // Records row boundaries only; fields are tokenized when a row is read.
+  void parse_lazy(char delimiter, size_t threads = 1);
+  // Restores a lazy row index saved in a sidecar, checking each row once
+  // as it is copied out. Throws if a row lies outside the data or the
+  // packed arrays disagree.
+  void load_lazy(char delimiter, const PackedRows &rows);
+
+  // Appends the rows of readers parsed the same way (same delimiter, column
+  // count and lazy or not; throws otherwise) after this reader's rows, so
+  // row(i) runs through every shard in order. The shards' row tables are
+  // copied here and freed; the shards stay owned by this reader, for their
+  // bytes, until the next parse.
+  void append(std::vector<std::unique_ptr<CsvReader>> shards);
+
+  // Stream mode: replaces the current block with the next run of complete
+  // rows, keeping the header line in front so data() and size() still look
+  // like a whole CSV. Rows and headers are invalid until the next parse.
+  // Returns false at end of input.
+  bool read_block();
+  // Bytes read from the stream so far.
+  size_t bytes_read() const { return stream_bytes_; }
 
   const char *data() const { return static_cast<const char *>(addr); }
   size_t size() const { return file_size_; }
+  // Bytes of input behind the rows: size(), or the whole decompressed file
+  // when only its tail was loaded, plus every appended shard.
+  size_t input_size() const {
+    return (seek_total_ ? seek_total_ : file_size_) + shard_bytes_;
+  }
   size_t row_count() const { return parsed_rows_; }
   size_t total_rows() const { return total_rows_; }
   size_t column_count() const { return ncols_; }
+  // Delimiter of the last parse.
+  char delimiter() const { return delim_; }
   const std::vector<std::string_view> &headers() const { return headers_; }
 
-  std::span<const std::string_view> row(size_t i) const {
-    return {fields_.data() + i * ncols_, ncols_};
+  RowView row(size_t i) const {
+    if (lazy_) {
+      uint32_t len = rows_.ends[i];
+      if (len == kWideRow)
+        return wide_row(i);
+      return {rows_.starts[i], len, delim_, ncols_};
+    }
+    const uint32_t *ends = rows_.ends.data() + i * ncols_;
+    if (ends[0] == kWideRow)
+      return wide_row(i);
+    return {rows_.starts[i], ends, ncols_};
   }
+
+  std::string_view field(size_t i, size_t col) const { return row(i)[col]; }
+
+  bool lazy() const { return lazy_; }
+  // Raw bytes of row i, without the line terminator. Lazy index only.
+  std::string_view row_span(size_t i) const;
 };
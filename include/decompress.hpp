@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class Compression { None, Gzip, Zstd };
+
+// Longest magic number detect_compression looks at.
+constexpr size_t kCompressionMagicBytes = 4;
+
+Compression detect_compression(const char *data, size_t len);
+
+// Compression of the bytes at fd's current offset, read with pread so
+// nothing is consumed. None when fd is not seekable.
+Compression peek_compression(int fd);
+
+// A place decompression can restart from without replaying what precedes
+// it. gzip points sit on deflate block boundaries and carry the 32 KB of
+// output the next blocks may refer back to (the zran technique); zstd points
+// sit on frame boundaries and need no state, so a file written as a single
+// frame has none past its start.
+struct SeekPoint {
+  uint64_t out = 0;       // uncompressed offset
+  uint64_t in = 0;        // compressed offset of the first whole byte
+  uint8_t bits = 0;       // gzip: bits of the byte before `in` still unread
+  bool in_quotes = false; // CSV quote state at out
+  bool row_start = true;  // out is the first byte of a row
+  std::string window;     // gzip: the output just before out
+};
+
+// Seek points of one compressed file, ascending; the first is always the
+// start of the file.
+struct SeekIndex {
+  Compression type = Compression::None;
+  uint64_t total_out = 0;
+  std::vector<SeekPoint> points;
+};
+
+// Default distance between seek points, in uncompressed bytes.
+constexpr uint64_t kSeekSpan = 16ull << 20;
+
+// Decompresses the whole file behind fd once from offset 0, recording a
+// point roughly every span bytes of output. A zstd file in the seekable
+// format has its frames listed up front and decoded on that many threads.
+// Throws std::runtime_error like Decompressor::read.
+SeekIndex build_seek_index(int fd, Compression c, uint64_t span = kSeekSpan,
+                           size_t threads = 1);
+
+// Streaming decompressor over a descriptor, read from its current offset.
+// prefix holds bytes already consumed from fd (e.g. while sniffing a pipe)
+// that precede them in the stream.
+class Decompressor {
+public:
+  virtual ~Decompressor() = default;
+
+  // Fills dst completely unless the stream ends first; returns 0 at the
+  // end. Throws std::runtime_error on corrupt or truncated input.
+  virtual size_t read(char *dst, size_t size) = 0;
+
+  // Throws std::runtime_error when glance was built without the codec.
+  static std::unique_ptr<Decompressor> open(int fd, Compression c,
+                                            std::string_view prefix = {});
+
+  // Resumes at a point of fd's seek index; fd is repositioned.
+  static std::unique_ptr<Decompressor> open_at(int fd, Compression c,
+                                               const SeekPoint &point);
+};
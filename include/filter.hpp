@@ -7,6 +7,7 @@
 #include <vector>
 
 class CsvReader;
+class ColumnStore;
 
 enum class FilterOp {
   Eq,
@@ -17,25 +18,65 @@ enum class FilterOp {
   Lte,
   Contains,
   StartsWith,
-  EndsWith
+  EndsWith,
+  In
 };
 
 struct Filter {
   std::string column;
   FilterOp op;
-  std::string value;
+  std::string value; // In: the comma-separated values
 };
 
 Filter parse_filter(std::string_view expr);
 
+// The trimmed, non-empty items of an In filter's value; an item in
+// double quotes may contain commas
+std::vector<std::string> in_values(const Filter &filter);
+
+// A boolean combination of comparisons
+struct FilterExpr {
+  enum class Kind { Compare, And, Or, Not };
+  Kind kind = Kind::Compare;
+  Filter filter;                    // Compare
+  std::vector<FilterExpr> operands; // And, Or: two or more; Not: one
+};
+
+// Parses comparisons joined by and, or and not (in any case), grouped
+// with parentheses; not binds tightest, then and. A value in double
+// quotes is taken as is. A string whose only comparison is its first part
+// is read as a single one, so a value may still contain these words
+// unquoted ("dept == R and D"); one that mixes comparisons with other
+// parts throws.
+FilterExpr parse_filter_expr(std::string_view expr);
+
+// The comparisons in an expression, left to right
+std::vector<const Filter *> expr_filters(const FilterExpr &expr);
+
+// Columns decoded in columns are compared through their typed values
+// rather than their text; cells that failed to decode still use the text.
+// Row ranges are split across threads; the matching rows come back in
+// order whatever the thread count.
 std::vector<size_t>
 apply_filters(const std::vector<Filter> &filters, const CsvReader &reader,
               const std::vector<ColumnSchema> &schema,
-              bool case_insensitive = false, bool or_logic = false);
+              bool case_insensitive = false, bool or_logic = false,
+              const ColumnStore *columns = nullptr, size_t threads = 1);
+
+// The rows matching an expression, in one pass. The expression is
+// compiled with constants folded; and/or evaluate their operands only on
+// the rows still undecided.
+std::vector<size_t> apply_filters(const FilterExpr &expr,
+                                  const CsvReader &reader,
+                                  const std::vector<ColumnSchema> &schema,
+                                  bool case_insensitive = false,
+                                  const ColumnStore *columns = nullptr,
+                                  size_t threads = 1);
 
 void sort_indices(std::vector<size_t> &indices, const CsvReader &reader,
                   const std::vector<ColumnSchema> &schema,
-                  const std::string &col_name, bool descending);
+                  const std::string &col_name, bool descending,
+                  const ColumnStore *columns = nullptr);
 
 std::vector<size_t> resolve_columns(const std::string &select_str,
                                     const CsvReader &reader);
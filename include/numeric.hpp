@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+class CsvReader;
+
+// Numeric cell parsers. None allocates or throws: each reports a value
+// that does not parse by returning false.
+
+// The whole of s as the type, with an optional sign; decimal digits only,
+// so inf, nan and hex do not parse
+bool parse_int64(std::string_view s, int64_t &value);
+bool parse_float64(std::string_view s, double &value);
+// A currency symbol and sign as parse_number reads them, and thousands
+// separators before the point; exact to two decimals
+bool parse_currency_cents(std::string_view s, int64_t &cents);
+
+// Any number a filter or sort compares: surrounding spaces, a currency
+// symbol ($, £, ¥ or €) before or after the sign, and thousands
+// separators are skipped, and the rest must be a decimal number with an
+// optional exponent. Unlike std::stod, trailing text ("12 kg"), hex and
+// inf/nan do not parse.
+bool parse_number(std::string_view s, double &value);
+
+// Batch form of parse_number over one column of a parsed reader: a value
+// per row, NaN where the cell is not a number or the row is not in rows
+// (when given). Quoted cells are read without their quotes.
+std::vector<double> parse_number_column(const CsvReader &reader, size_t col,
+                                        const std::vector<size_t> *rows =
+                                            nullptr,
+                                        size_t threads = 1);
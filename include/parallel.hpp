@@ -0,0 +1,61 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+size_t default_thread_count();
+
+// Rows each thread of a pass over rows should get for starting it to pay
+// off, when a row costs a few field parses or comparisons
+constexpr size_t kMinRowsPerThread = 1 << 14;
+
+// How many of threads to split count items over so each gets at least
+// min_per_thread of them; never less than one.
+inline size_t threads_for(size_t count, size_t threads,
+                          size_t min_per_thread = kMinRowsPerThread) {
+  return std::max<size_t>(1, std::min(threads, count / min_per_thread));
+}
+
+// First item of part t when count items are split into n ordered parts;
+// part t ends where part t + 1 begins.
+inline size_t part_begin(size_t count, size_t n, size_t t) {
+  return count * t / n;
+}
+
+// Runs fn(t) for every t in [0, n), one thread per task. Task 0 runs on the
+// calling thread. The first exception thrown by any task is rethrown here
+// after all tasks have joined.
+template <typename Fn> void run_parallel(size_t n, Fn &&fn) {
+  if (n == 0)
+    return;
+  if (n == 1) {
+    fn(static_cast<size_t>(0));
+    return;
+  }
+
+  std::vector<std::exception_ptr> errors(n);
+  std::vector<std::thread> workers;
+  workers.reserve(n - 1);
+  for (size_t t = 1; t < n; ++t) {
+    workers.emplace_back([&, t]() {
+      try {
+        fn(t);
+      } catch (...) {
+        errors[t] = std::current_exception();
+      }
+    });
+  }
+  try {
+    fn(static_cast<size_t>(0));
+  } catch (...) {
+    errors[0] = std::current_exception();
+  }
+  for (auto &w : workers)
+    w.join();
+  for (auto &e : errors)
+    if (e)
+      std::rethrow_exception(e);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "include/column_stats.hpp"
+#include "include/csv_reader.hpp"
+#include "include/type_inference.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct SeekIndex;
+
+// What a re-open of the same CSV would otherwise recompute: the delimiter,
+// the lazy row index, the inferred schema and per-column statistics. Kept
+// next to the CSV as <file>.glance-idx and trusted only while the CSV's
+// size, mtime and header line are unchanged.
+// The row index is read in place: rows points into the mapped sidecar,
+// which stays mapped while the SidecarIndex (or a copy) lives.
+struct SidecarIndex {
+  char delimiter = ',';
+  PackedRows rows; // for CsvReader::load_lazy
+  std::vector<ColumnSchema> schema;
+  std::vector<ColumnStats> stats;
+  std::shared_ptr<const char> mapping;
+};
+
+std::string sidecar_path(const std::string &csv_path);
+
+// Writes the sidecar for a reader holding a lazy row index. The file is
+// replaced atomically; throws std::runtime_error on failure.
+void write_sidecar(const std::string &csv_path, const CsvReader &reader,
+                   char delimiter, const std::vector<ColumnSchema> &schema,
+                   size_t threads = 1);
+
+// Returns false if csv_path has no sidecar, or it is malformed or stale.
+bool load_sidecar(const std::string &csv_path, const CsvReader &reader,
+                  SidecarIndex &out);
+
+// A compressed file's seek index (see decompress.hpp) lives in the same
+// <file>.glance-idx slot, stamped with the compressed file. Writing throws
+// std::runtime_error on failure; loading returns false if it is missing,
+// malformed or stale.
+void write_seek_index(const std::string &path, const SeekIndex &index);
+bool load_seek_index(const std::string &path, SeekIndex &out);
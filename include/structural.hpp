@@ -0,0 +1,60 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Inclusive prefix XOR: bit i of the result is the parity of bits [0, i].
+uint64_t prefix_xor(uint64_t bits);
+
+// Position of the first newline at or after start that lies outside quotes,
+// given the quote state at start. Returns total when there is none.
+size_t find_row_end(const char *base, size_t total, size_t start,
+                    bool in_quotes = false);
+
+// Appends the offset of every newline outside quotes in [begin, end) to out,
+// given the quote state at begin. Returns the quote state at end.
+bool find_row_ends(const char *base, size_t begin, size_t end, bool in_quotes,
+                   std::vector<size_t> &out);
+
+// Newline counts over a range that starts outside quotes. Counting a range
+// that actually starts inside quotes swaps the roles of inside and outside,
+// so chunks counted independently can be combined once their starting quote
+// states are known: outside' = newlines - outside.
+struct RowEndCount {
+  size_t outside = 0;  // newlines outside quotes
+  size_t newlines = 0; // all newlines
+  bool odd_quotes = false;
+};
+
+RowEndCount count_row_ends(const char *data, size_t len);
+
+// simdjson-style stage 1 over one window of a CSV body. The window must begin
+// at a row boundary (outside quotes). Every 64-byte block is classified into
+// quote/delimiter/newline bitmasks, the in-quote mask is recovered with a
+// prefix XOR, and the delimiters and newlines outside quotes are extracted as
+// offsets relative to the window start.
+//
+// Blocks whose quoting is irregular (a quote that does not open a field,
+// close one, or form a "" escape) are flagged as not clean: the parity model
+// and the field state machine in CsvReader can disagree there, so rows that
+// touch them must be tokenized by the scalar path.
+class StructuralIndex {
+  std::vector<uint32_t> positions_;
+  std::vector<uint8_t> dirty_; // one flag per 64-byte block
+
+public:
+  void build(const char *base, size_t begin, size_t end, char delim);
+
+  const std::vector<uint32_t> &positions() const { return positions_; }
+
+  // True when no block overlapping window offsets [from, to] is dirty.
+  bool clean(size_t from, size_t to) const {
+    size_t last = std::min(to / 64, dirty_.empty() ? 0 : dirty_.size() - 1);
+    for (size_t b = from / 64; b <= last && b < dirty_.size(); ++b)
+      if (dirty_[b])
+        return false;
+    return true;
+  }
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// A needle prepared once for many searches, optionally ignoring ASCII
+// case. find compares the needle's first and last bytes against 16 or 32
+// haystack positions at a time (SSE2, AVX2 or NEON) and checks only the
+// positions where both match; nothing is copied or lowercased per
+// haystack.
+class TextMatcher {
+public:
+  static constexpr size_t npos = std::string_view::npos;
+
+  TextMatcher() = default;
+  explicit TextMatcher(std::string_view needle, bool ignore_case = false);
+
+  // The needle, lowercased when ignoring case
+  const std::string &needle() const { return needle_; }
+
+  // Offset of the first occurrence in s, or npos; an empty needle is
+  // found at 0
+  size_t find(std::string_view s) const;
+  bool contains(std::string_view s) const { return find(s) != npos; }
+  bool starts_with(std::string_view s) const;
+  bool ends_with(std::string_view s) const;
+  bool equals(std::string_view s) const;
+
+private:
+  std::string needle_;
+  bool ignore_case_ = false;
+  // Both cases of the needle's first and last bytes
+  char first_[2] = {}, last_[2] = {};
+
+  // Whether the needle.size() bytes at p are the needle
+  bool matches_at(const char *p) const;
+};
+
+// Whether n bytes at p, with ASCII letters lowercased, equal n bytes of
+// lowercase text
+bool equal_folded(const char *p, const char *lower, size_t n);
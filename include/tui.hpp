@@ -5,6 +5,7 @@
 #include <vector>
 
 class CsvReader;
+struct ColumnStats;
 
 std::pair<size_t, size_t> get_terminal_size();
 
@@ -14,9 +15,11 @@ void render_table(const CsvReader &reader,
                   const std::vector<size_t> *col_indices, size_t max_rows,
                   size_t total_match_count);
 
+// With stats, each column also carries its statistics (see ColumnStats)
 void render_schema_json(const std::vector<ColumnSchema> &schema,
                         const std::vector<size_t> *col_indices,
-                        size_t row_count, size_t file_size);
+                        size_t row_count, size_t file_size,
+                        const std::vector<ColumnStats> *stats = nullptr);
 
 void render_csv(const CsvReader &reader,
                 const std::vector<size_t> *row_indices,
@@ -27,3 +30,26 @@ void render_json(const CsvReader &reader,
                  const std::vector<ColumnSchema> &schema,
                  const std::vector<size_t> *row_indices,
                  const std::vector<size_t> *col_indices, size_t max_rows);
+
+// Incremental output for input read in blocks: the header or opening
+// bracket once, the rows of every block as it is parsed, then the closing
+// bracket. The concatenation matches render_csv / render_json.
+void render_csv_header(const CsvReader &reader,
+                       const std::vector<size_t> *col_indices,
+                       char delimiter);
+
+void render_csv_rows(const CsvReader &reader,
+                     const std::vector<size_t> *row_indices,
+                     const std::vector<size_t> *col_indices, size_t max_rows,
+                     char delimiter);
+
+void render_json_begin();
+
+// written counts the rows emitted so far across blocks and is advanced.
+void render_json_rows(const CsvReader &reader,
+                      const std::vector<ColumnSchema> &schema,
+                      const std::vector<size_t> *row_indices,
+                      const std::vector<size_t> *col_indices, size_t max_rows,
+                      size_t &written);
+
+void render_json_end(size_t written);
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <string_view>
+#include <unordered_set>
 #include <vector>
 
 class CsvReader;
@@ -15,5 +18,42 @@ struct ColumnSchema {
 
 std::string_view type_name(ColumnType t);
 
+// At most this many of the budget come from the reader's parsed rows
+constexpr size_t kInferenceHeadRows = 100;
+constexpr size_t kInferenceBudget = 1000;
+
+// Types each column from up to budget rows: the first parsed rows plus rows
+// at stratified byte offsets across the whole input (see
+// CsvReader::stratified_rows), so a column that changes type deep into the
+// file is caught even when only the head was parsed.
 std::vector<ColumnSchema> infer_schema(const CsvReader &reader,
-                                       size_t sample_size = 100);
+                                       size_t budget = kInferenceBudget);
+
+// Exact mode tracks distinct values only up to this many; a column with
+// more is never an enum
+constexpr size_t kEnumMaxValues = 4096;
+
+// Exact column types accumulated over every row of one or more readers
+// with the same columns, such as the blocks of a stream. Each value is
+// classified once; enum needs every value of the column seen, so a column
+// that only turns untyped in a later reader reports text.
+class SchemaTally {
+public:
+  void add(const CsvReader &reader, size_t threads = 1);
+  std::vector<ColumnSchema> schema() const;
+
+private:
+  struct Column {
+    std::string name;
+    uint8_t types;        // candidate types every value so far satisfies
+    size_t values = 0;    // non-empty values
+    bool complete = true; // every value is in distinct
+    bool overflow = false;
+    std::unordered_set<std::string> distinct;
+  };
+  std::vector<Column> columns_;
+};
+
+// Types every parsed row of reader, split across threads.
+std::vector<ColumnSchema> infer_schema_exact(const CsvReader &reader,
+                                             size_t threads = 1);
@@ -0,0 +1,271 @@
+#include "include/column_stats.hpp"
+#include "include/columns.hpp"
+#include "include/csv_reader.hpp"
+#include "include/parallel.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+
+// --- Field helpers ---
+
+static size_t unquoted_size(std::string_view field) {
+  if (field.size() < 2 || field.front() != '"' || field.back() != '"')
+    return field.size();
+  size_t n = field.size() - 2;
+  for (size_t i = 1; i + 1 < field.size(); ++i) {
+    if (field[i] == '"' && i + 2 < field.size() && field[i + 1] == '"') {
+      --n;
+      ++i;
+    }
+  }
+  return n;
+}
+
+// Collapses the doubled quotes strip_quotes leaves in place
+static std::string unescape(std::string_view v) {
+  std::string out;
+  out.reserve(v.size());
+  for (size_t i = 0; i < v.size(); ++i) {
+    out += v[i];
+    if (v[i] == '"' && i + 1 < v.size() && v[i + 1] == '"')
+      ++i;
+  }
+  return out;
+}
+
+// --- HyperLogLog ---
+
+static constexpr unsigned kRegisterBits = 12;
+static_assert(kDistinctRegisters == size_t{1} << kRegisterBits);
+
+static uint64_t mix64(uint64_t x) {
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  return x ^ (x >> 31);
+}
+
+static uint64_t hash_bytes(const char *p, size_t n) {
+  uint64_t h = mix64(n + 0x9e3779b97f4a7c15ull);
+  for (; n >= 8; p += 8, n -= 8) {
+    uint64_t w;
+    std::memcpy(&w, p, 8);
+    h = mix64(h ^ w);
+  }
+  uint64_t w = 0;
+  std::memcpy(&w, p, n);
+  return mix64(h ^ w);
+}
+
+// The top bits of the hash pick a register, which keeps the longest run of
+// leading zeros seen in the rest
+static void sketch(std::vector<uint8_t> &registers, std::string_view v) {
+  uint64_t h = hash_bytes(v.data(), v.size());
+  size_t idx = h >> (64 - kRegisterBits);
+  uint64_t rest = (h << kRegisterBits) | (uint64_t{1} << (kRegisterBits - 1));
+  auto rank = static_cast<uint8_t>(std::countl_zero(rest) + 1);
+  registers[idx] = std::max(registers[idx], rank);
+}
+
+static uint64_t estimate(const std::vector<uint8_t> &registers) {
+  double m = static_cast<double>(registers.size());
+  double sum = 0.0;
+  size_t zeros = 0;
+  for (uint8_t r : registers) {
+    sum += std::ldexp(1.0, -r);
+    zeros += r == 0;
+  }
+  double e = 0.7213 / (1.0 + 1.079 / m) * m * m / sum;
+  // Small cardinalities: linear counting over the empty registers
+  if (e <= 2.5 * m && zeros > 0)
+    e = m * std::log(m / static_cast<double>(zeros));
+  return static_cast<uint64_t>(std::llround(e));
+}
+
+// --- Typed values ---
+
+struct Key {
+  int64_t i = 0;         // int64, currency cents, days, bools
+  double f = 0.0;        // float64
+  std::string_view text; // as written, quotes stripped
+  bool number = false;   // counts toward mean and stddev
+  double value = 0.0;
+};
+
+// Parses a non-empty value as the column's type
+static bool typed_key(ColumnType type, std::string_view v, Key &k) {
+  k.text = v;
+  switch (type) {
+  case ColumnType::Int64:
+    if (!parse_int64(v, k.i))
+      return false;
+    k.number = true;
+    k.value = static_cast<double>(k.i);
+    return true;
+  case ColumnType::Float64:
+    if (!parse_float64(v, k.f))
+      return false;
+    k.number = true;
+    k.value = k.f;
+    return true;
+  case ColumnType::Currency:
+    if (!parse_currency_cents(v, k.i))
+      return false;
+    k.number = true;
+    k.value = static_cast<double>(k.i) / 100.0;
+    return true;
+  case ColumnType::Date:
+    return parse_date_days(v, k.i);
+  case ColumnType::Bool: {
+    bool b;
+    if (!parse_bool(v, b))
+      return false;
+    k.i = b;
+    return true;
+  }
+  default:
+    return true;
+  }
+}
+
+static bool key_less(ColumnType type, const Key &a, const Key &b) {
+  if (type == ColumnType::Float64)
+    return a.f < b.f;
+  if (type == ColumnType::Enum || type == ColumnType::Text)
+    return a.text < b.text;
+  return a.i < b.i;
+}
+
+// Folds the count, mean and squared deviations of one sample into another
+// (Chan et al.)
+static void merge_moments(uint64_t &n, double &mean, double &m2, uint64_t nb,
+                          double mean_b, double m2_b) {
+  if (nb == 0)
+    return;
+  uint64_t total = n + nb;
+  double d = mean_b - mean;
+  double na_f = static_cast<double>(n), nb_f = static_cast<double>(nb);
+  mean += d * nb_f / static_cast<double>(total);
+  m2 += m2_b + d * d * na_f * nb_f / static_cast<double>(total);
+  n = total;
+}
+
+// --- Tally ---
+
+StatsTally::StatsTally(std::vector<ColumnSchema> schema)
+    : schema_(std::move(schema)), columns_(schema_.size()) {}
+
+void StatsTally::add(const CsvReader &reader, size_t threads,
+                     const std::vector<size_t> *rows) {
+  size_t ncols = std::min(reader.column_count(), columns_.size());
+  size_t count = rows ? rows->size() : reader.row_count();
+  // Every column of a row is tallied, so fewer rows make a thread's worth
+  size_t n = threads_for(count, threads, kMinRowsPerThread / 4);
+
+  struct Local {
+    uint64_t nulls = 0;
+    uint64_t max_width = 0;
+    uint64_t numbers = 0;
+    double mean = 0.0;
+    double m2 = 0.0;
+    bool has_range = false;
+    Key min, max;
+    std::vector<uint8_t> registers = std::vector<uint8_t>(kDistinctRegisters);
+  };
+  std::vector<std::vector<Local>> locals(n, std::vector<Local>(ncols));
+
+  run_parallel(n, [&](size_t t) {
+    auto &cols = locals[t];
+    for (size_t k = part_begin(count, n, t), end = part_begin(count, n, t + 1);
+         k < end; ++k) {
+      auto row = reader.row(rows ? (*rows)[k] : k);
+      for (size_t c = 0; c < ncols; ++c) {
+        Local &l = cols[c];
+        auto raw = row[c];
+        size_t width = unquoted_size(raw);
+        l.max_width = std::max<uint64_t>(l.max_width, width);
+        if (width == 0) {
+          ++l.nulls;
+          continue;
+        }
+        auto v = strip_quotes(raw);
+        sketch(l.registers, v);
+
+        ColumnType type = schema_[c].type;
+        Key key;
+        if (!typed_key(type, v, key))
+          continue;
+        if (key.number) {
+          // Welford's update
+          ++l.numbers;
+          double d = key.value - l.mean;
+          l.mean += d / static_cast<double>(l.numbers);
+          l.m2 += d * (key.value - l.mean);
+        }
+        if (!l.has_range || key_less(type, key, l.min))
+          l.min = key;
+        if (!l.has_range || key_less(type, l.max, key))
+          l.max = key;
+        l.has_range = true;
+      }
+    }
+  });
+
+  for (size_t c = 0; c < ncols; ++c) {
+    Column &col = columns_[c];
+    ColumnType type = schema_[c].type;
+    for (auto &cols : locals) {
+      const Local &l = cols[c];
+      col.nulls += l.nulls;
+      col.max_width = std::max(col.max_width, l.max_width);
+      merge_moments(col.numbers, col.mean, col.m2, l.numbers, l.mean, l.m2);
+      for (size_t i = 0; i < kDistinctRegisters; ++i)
+        col.registers[i] = std::max(col.registers[i], l.registers[i]);
+      if (!l.has_range)
+        continue;
+
+      Key lo{col.min_int, col.min_float, col.min_text};
+      Key hi{col.max_int, col.max_float, col.max_text};
+      if (!col.has_range || key_less(type, l.min, lo)) {
+        col.min_int = l.min.i;
+        col.min_float = l.min.f;
+        col.min_text.assign(l.min.text);
+      }
+      if (!col.has_range || key_less(type, hi, l.max)) {
+        col.max_int = l.max.i;
+        col.max_float = l.max.f;
+        col.max_text.assign(l.max.text);
+      }
+      col.has_range = true;
+    }
+  }
+}
+
+std::vector<ColumnStats> StatsTally::stats() const {
+  std::vector<ColumnStats> out(columns_.size());
+  for (size_t c = 0; c < columns_.size(); ++c) {
+    const Column &col = columns_[c];
+    ColumnStats &s = out[c];
+    s.nulls = col.nulls;
+    s.max_width = col.max_width;
+    s.distinct = estimate(col.registers);
+    if (col.has_range) {
+      s.min = unescape(col.min_text);
+      s.max = unescape(col.max_text);
+    }
+    s.numbers = col.numbers;
+    s.mean = col.mean;
+    if (col.numbers > 1)
+      s.stddev = std::sqrt(col.m2 / static_cast<double>(col.numbers - 1));
+  }
+  return out;
+}
+
+std::vector<ColumnStats>
+compute_column_stats(const CsvReader &reader,
+                     const std::vector<ColumnSchema> &schema, size_t threads,
+                     const std::vector<size_t> *rows) {
+  StatsTally tally(schema);
+  tally.add(reader, threads, rows);
+  return tally.stats();
+}
@@ -0,0 +1,203 @@
+#include "include/columns.hpp"
+#include "include/csv_reader.hpp"
+#include "include/parallel.hpp"
+#include <algorithm>
+#include <unordered_map>
+
+double TypedColumn::number(size_t row) const {
+  switch (type) {
+  case ColumnType::Int64:
+  case ColumnType::Date:
+    return static_cast<double>(ints[row]);
+  case ColumnType::Currency:
+    return static_cast<double>(ints[row]) / 100.0;
+  case ColumnType::Float64:
+    return floats[row];
+  default:
+    return 0.0;
+  }
+}
+
+// --- Value parsers ---
+
+// Days from 1970-01-01 to a proleptic Gregorian date
+static int64_t days_from_civil(int64_t y, unsigned m, unsigned d) {
+  y -= m <= 2;
+  int64_t era = (y >= 0 ? y : y - 399) / 400;
+  unsigned yoe = static_cast<unsigned>(y - era * 400);
+  unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+  unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+bool parse_date_days(std::string_view s, int64_t &days) {
+  if (s.size() != 10)
+    return false;
+  auto number = [&](size_t at, size_t len, unsigned &out) {
+    out = 0;
+    for (size_t i = at; i < at + len; ++i) {
+      if (s[i] < '0' || s[i] > '9')
+        return false;
+      out = out * 10 + static_cast<unsigned>(s[i] - '0');
+    }
+    return true;
+  };
+  auto sep = [&](size_t at) { return s[at] == '-' || s[at] == '/'; };
+
+  unsigned y, m, d;
+  if (sep(4) && sep(7)) {
+    if (!number(0, 4, y) || !number(5, 2, m) || !number(8, 2, d))
+      return false;
+  } else if (sep(2) && sep(5)) {
+    if (!number(0, 2, m) || !number(3, 2, d) || !number(6, 4, y))
+      return false;
+    if (m > 12 && d <= 12)
+      std::swap(m, d);
+  } else {
+    return false;
+  }
+
+  static constexpr unsigned kMonthDays[] = {31, 28, 31, 30, 31, 30,
+                                            31, 31, 30, 31, 30, 31};
+  if (m < 1 || m > 12 || d < 1)
+    return false;
+  bool leap = (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+  if (d > kMonthDays[m - 1] + (m == 2 && leap))
+    return false;
+  days = days_from_civil(y, m, d);
+  return true;
+}
+
+bool parse_bool(std::string_view s, bool &value) {
+  if (s.empty() || s.size() > 5)
+    return false;
+  char buf[5];
+  for (size_t i = 0; i < s.size(); ++i)
+    buf[i] = static_cast<char>(s[i] >= 'A' && s[i] <= 'Z' ? s[i] + 32 : s[i]);
+  std::string_view lower(buf, s.size());
+  if (lower == "true" || lower == "yes" || lower == "1")
+    value = true;
+  else if (lower == "false" || lower == "no" || lower == "0")
+    value = false;
+  else
+    return false;
+  return true;
+}
+
+// --- Column decoding ---
+
+static bool decode(TypedColumn &c, size_t row, std::string_view v) {
+  switch (c.type) {
+  case ColumnType::Int64:
+    return parse_int64(v, c.ints[row]);
+  case ColumnType::Float64:
+    return parse_float64(v, c.floats[row]);
+  case ColumnType::Currency:
+    return parse_currency_cents(v, c.ints[row]);
+  case ColumnType::Date:
+    return parse_date_days(v, c.ints[row]);
+  case ColumnType::Bool: {
+    bool b;
+    if (!parse_bool(v, b))
+      return false;
+    if (b)
+      c.bools[row >> 6] |= uint64_t{1} << (row & 63);
+    return true;
+  }
+  default:
+    return false;
+  }
+}
+
+ColumnStore::ColumnStore(const CsvReader &reader,
+                         const std::vector<ColumnSchema> &schema,
+                         const std::vector<size_t> &columns, size_t threads) {
+  size_t rows = reader.row_count();
+  size_t words = (rows + 63) / 64;
+
+  // Threads take slices of whole bitmap words, so none shares a word
+  size_t n = threads_for(words, threads, kMinRowsPerThread / 64);
+  auto first_row = [&](size_t t) {
+    return std::min(rows, part_begin(words, n, t) * 64);
+  };
+  auto set_valid = [](TypedColumn &c, size_t row) {
+    c.valid[row >> 6] |= uint64_t{1} << (row & 63);
+  };
+
+  columns_.resize(reader.column_count());
+  for (size_t col : columns) {
+    if (col >= columns_.size() || col >= schema.size() || columns_[col] ||
+        schema[col].type == ColumnType::Text)
+      continue;
+    auto tc = std::make_unique<TypedColumn>();
+    TypedColumn &c = *tc;
+    c.type = schema[col].type;
+    c.valid.assign(words, 0);
+
+    switch (c.type) {
+    case ColumnType::Float64:
+      c.floats.resize(rows);
+      break;
+    case ColumnType::Bool:
+      c.bools.assign(words, 0);
+      break;
+    case ColumnType::Enum:
+      c.codes.resize(rows);
+      break;
+    default:
+      c.ints.resize(rows);
+      break;
+    }
+
+    if (c.type != ColumnType::Enum) {
+      run_parallel(n, [&](size_t t) {
+        for (size_t r = first_row(t), end = first_row(t + 1); r < end; ++r) {
+          auto v = strip_quotes(reader.row(r)[col]);
+          if (!v.empty() && decode(c, r, v))
+            set_valid(c, r);
+        }
+      });
+      columns_[col] = std::move(tc);
+      continue;
+    }
+
+    // Enum: each thread codes its rows against its own dictionary of raw
+    // fields; the dictionaries are then merged, unquoted and sorted, and
+    // the codes rewritten
+    std::vector<std::vector<std::string_view>> locals(n);
+    run_parallel(n, [&](size_t t) {
+      std::unordered_map<std::string_view, uint32_t> seen;
+      auto &values = locals[t];
+      for (size_t r = first_row(t), end = first_row(t + 1); r < end; ++r) {
+        auto raw = reader.row(r)[col];
+        auto [it, added] =
+            seen.try_emplace(raw, static_cast<uint32_t>(values.size()));
+        if (added)
+          values.push_back(raw);
+        c.codes[r] = it->second;
+        if (!strip_quotes(raw).empty())
+          set_valid(c, r);
+      }
+    });
+
+    for (auto &values : locals)
+      for (auto raw : values)
+        c.dictionary.push_back(unquote(raw));
+    std::sort(c.dictionary.begin(), c.dictionary.end());
+    c.dictionary.erase(std::unique(c.dictionary.begin(), c.dictionary.end()),
+                       c.dictionary.end());
+
+    run_parallel(n, [&](size_t t) {
+      std::vector<uint32_t> remap;
+      remap.reserve(locals[t].size());
+      for (auto raw : locals[t]) {
+        auto it = std::lower_bound(c.dictionary.begin(), c.dictionary.end(),
+                                   unquote(raw));
+        remap.push_back(static_cast<uint32_t>(it - c.dictionary.begin()));
+      }
+      for (size_t r = first_row(t), end = first_row(t + 1); r < end; ++r)
+        c.codes[r] = remap[c.codes[r]];
+    });
+    columns_[col] = std::move(tc);
+  }
+}
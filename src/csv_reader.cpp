@@ -1,11 +1,21 @@
 #include "include/csv_reader.hpp"
+#include "include/decompress.hpp"
+#include "include/parallel.hpp"
+#include "include/structural.hpp"
 #include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
 #include <cstring>
 #include <fcntl.h>
+#include <functional>
+#include <mutex>
 #include <stdexcept>
 #include <string>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <thread>
+#include <unordered_set>
 #include <unistd.h>
 
 #ifdef __ARM_NEON
@@ -35,14 +45,14 @@ std::string unquote(std::string_view field) {
   return std::string(field);
 }
 
-// --- SIMD-accelerated newline counting ---
+// --- SIMD-accelerated byte counting ---
 
-static size_t count_newlines(const char *data, size_t len) {
+static size_t count_byte(const char *data, size_t len, char c) {
   size_t count = 0;
   size_t i = 0;
 
 #ifdef __ARM_NEON
-  uint8x16_t nl = vdupq_n_u8('\n');
+  uint8x16_t nl = vdupq_n_u8(static_cast<uint8_t>(c));
   uint8x16_t ones = vdupq_n_u8(1);
 
   while (i + 16 <= len) {
@@ -58,7 +68,7 @@ static size_t count_newlines(const char *data, size_t len) {
     count += vaddvq_u8(acc);
   }
 #elif defined(__SSE2__)
-  __m128i nl = _mm_set1_epi8('\n');
+  __m128i nl = _mm_set1_epi8(c);
 
   while (i + 16 <= len) {
     int batch_count = 0;
@@ -76,7 +86,7 @@ static size_t count_newlines(const char *data, size_t len) {
 #endif
 
   for (; i < len; ++i)
-    if (data[i] == '\n')
+    if (data[i] == c)
       ++count;
 
   return count;
@@ -95,15 +105,8 @@ static size_t find_line_end(const char *base, size_t total, size_t start) {
   if (!q)
     return nl_pos; // No quotes → newline is a row boundary
 
-  // Slow path: quote-aware scan
-  bool in_quotes = false;
-  for (size_t i = start; i < total; ++i) {
-    if (base[i] == '"')
-      in_quotes = !in_quotes;
-    else if (!in_quotes && base[i] == '\n')
-      return i;
-  }
-  return total;
+  // Slow path: quote-aware SIMD scan
+  return find_row_end(base, total, start);
 }
 
 // --- Field parsing (directly into flat storage) ---
@@ -147,11 +150,191 @@ parse_line_fields(const char *base, size_t start, size_t end, char delim) {
   return fields;
 }
 
+// --- I/O options ---
+
+IoOptions parse_io_options(std::string_view spec) {
+  IoOptions io;
+  while (!spec.empty()) {
+    size_t comma = spec.find(',');
+    std::string_view name = spec.substr(0, comma);
+    if (name == "sequential")
+      io.sequential = true;
+    else if (name == "willneed")
+      io.willneed = true;
+    else if (name == "populate")
+      io.populate = true;
+    else if (name == "hugepages")
+      io.hugepages = true;
+    else if (name == "dropbehind")
+      io.drop_behind = true;
+    else if (name == "pread")
+      io.pread = true;
+    else if (!name.empty())
+      throw std::runtime_error("Unknown I/O option: " + std::string(name));
+    spec = (comma == std::string_view::npos) ? std::string_view()
+                                             : spec.substr(comma + 1);
+  }
+  return io;
+}
+
+// One read() of up to size bytes, retried on EINTR; sets eof at the end.
+static size_t read_some(int fd, char *buf, size_t size, bool &eof) {
+  while (true) {
+    ssize_t n = ::read(fd, buf, size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0)
+      throw std::runtime_error("Failed to read stdin");
+    eof = n == 0;
+    return static_cast<size_t>(n);
+  }
+}
+
+static constexpr size_t kPreadChunkBytes = 8 << 20;
+static constexpr size_t kPreadThreads = 4;
+
+// Reads fd at offset until size bytes are filled or EOF; returns the bytes
+// read.
+static size_t pread_full(int fd, char *buf, size_t size, off_t offset) {
+  size_t done = 0;
+  while (done < size) {
+    ssize_t n = ::pread(fd, buf + done, size - done,
+                        offset + static_cast<off_t>(done));
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0)
+      throw std::runtime_error("Failed to read file");
+    if (n == 0)
+      break;
+    done += static_cast<size_t>(n);
+  }
+  return done;
+}
+
+// Fills buf from fd until full or EOF, with pread at explicit offsets when
+// fd is seekable; returns the bytes read.
+static std::function<size_t(char *, size_t)> fd_source(int fd) {
+  return [fd, offset = lseek(fd, 0, SEEK_CUR)](char *buf,
+                                               size_t size) mutable {
+    if (offset >= 0) {
+      size_t n = pread_full(fd, buf, size, offset);
+      offset += static_cast<off_t>(n);
+      return n;
+    }
+    size_t done = 0;
+    while (done < size) {
+      ssize_t n = ::read(fd, buf + done, size - done);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n < 0)
+        throw std::runtime_error("Failed to read stdin");
+      if (n == 0)
+        break;
+      done += static_cast<size_t>(n);
+    }
+    return done;
+  };
+}
+
+static constexpr size_t kReadAheadSlots = 4;
+
+// A ring of blocks filled by a background thread while the caller parses
+// earlier ones, so reading (or decompressing) overlaps parsing. The source
+// fills each block completely unless the input ends.
+struct CsvReader::ReadAhead {
+  std::function<size_t(char *, size_t)> source;
+  std::vector<std::vector<char>> slots;
+  std::vector<size_t> lens;
+  size_t head = 0;  // slot the caller reads from
+  size_t tail = 0;  // slot the worker fills next
+  size_t count = 0; // filled slots, including the one at head
+  bool holding = false;
+  size_t pos = 0; // bytes of slots[head] already handed out
+  bool done = false;
+  bool stop = false;
+  std::exception_ptr error;
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::thread worker;
+
+  ReadAhead(std::function<size_t(char *, size_t)> src, size_t block)
+      : source(std::move(src)),
+        slots(kReadAheadSlots, std::vector<char>(block)),
+        lens(kReadAheadSlots, 0), worker([this]() { run(); }) {}
+
+  ~ReadAhead() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stop = true;
+    }
+    cv.notify_all();
+    worker.join();
+  }
+
+  void run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      cv.wait(lock, [&]() { return stop || count < slots.size(); });
+      if (stop)
+        return;
+      size_t slot = tail;
+      lock.unlock();
+      size_t n = 0;
+      try {
+        n = source(slots[slot].data(), slots[slot].size());
+      } catch (...) {
+        lock.lock();
+        error = std::current_exception();
+        done = true;
+        cv.notify_all();
+        return;
+      }
+      lock.lock();
+      if (n > 0) {
+        lens[slot] = n;
+        tail = (tail + 1) % slots.size();
+        ++count;
+      }
+      done = n < slots[slot].size();
+      cv.notify_all();
+      if (done)
+        return;
+    }
+  }
+
+  // Copies up to size bytes into dst; returns 0 only at end of input.
+  size_t take(char *dst, size_t size) {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!holding || pos == lens[head]) {
+      if (holding) {
+        // Hand the drained slot back to the worker
+        holding = false;
+        head = (head + 1) % slots.size();
+        --count;
+        cv.notify_all();
+      }
+      cv.wait(lock, [&]() { return count > 0 || done; });
+      if (count == 0) {
+        if (error)
+          std::rethrow_exception(error);
+        return 0;
+      }
+      holding = true;
+      pos = 0;
+    }
+    lock.unlock();
+    size_t n = std::min(size, lens[head] - pos);
+    std::memcpy(dst, slots[head].data() + pos, n);
+    pos += n;
+    return n;
+  }
+};
+
 // --- CsvReader implementation ---
 
-CsvReader::CsvReader(const char *file_name) {
+CsvReader::CsvReader(const char *file_name, const IoOptions &io) : io_(io) {
   if (std::strcmp(file_name, "-") == 0) {
-    read_stdin();
+    load_descriptor(STDIN_FILENO);
     return;
   }
 
@@ -164,32 +347,458 @@ CsvReader::CsvReader(const char *file_name) {
     close(this->csv_fd);
     throw std::runtime_error("Failed to get length of the file");
   }
+
+  // Paths like /dev/stdin can name a pipe; those are drained like stdin
+  if (!S_ISREG(sbuf.st_mode)) {
+    int fd = this->csv_fd;
+    this->csv_fd = -1;
+    try {
+      load_descriptor(fd);
+    } catch (...) {
+      close(fd);
+      throw;
+    }
+    close(fd);
+    return;
+  }
   this->file_size_ = static_cast<size_t>(sbuf.st_size);
 
-  if (this->file_size_ > 0)
-    handle_mmap();
+  if (Compression c = peek_compression(this->csv_fd);
+      c != Compression::None) {
+    decompress_all(this->csv_fd, c);
+    return;
+  }
+  if (this->file_size_ > 0 && io_.pread)
+    read_file(this->csv_fd, 0);
+  else if (this->file_size_ > 0)
+    handle_mmap(this->csv_fd, 0);
 }
 
-void CsvReader::read_stdin() {
-  // Read all of stdin into a buffer
-  constexpr size_t chunk = 1 << 16; // 64KB
-  char buf[chunk];
-  ssize_t n;
-  while ((n = ::read(STDIN_FILENO, buf, chunk)) > 0)
-    stdin_buf_.append(buf, static_cast<size_t>(n));
+// A redirected regular file is mapped from its current offset, exactly like
+// a path; anything else is drained into memory first.
+void CsvReader::load_descriptor(int fd) {
+  // Compressed input, regular or piped, is decompressed into memory
+  if (Compression c = detect_input(fd); c != Compression::None) {
+    decompress_all(fd, c);
+    return;
+  }
+
+  struct stat sbuf;
+  if (fstat(fd, &sbuf) == 0 && S_ISREG(sbuf.st_mode)) {
+    off_t pos = lseek(fd, 0, SEEK_CUR);
+    if (pos < 0)
+      pos = 0;
+    if (pos >= sbuf.st_size)
+      throw std::runtime_error("No data on stdin");
+    file_size_ = static_cast<size_t>(sbuf.st_size - pos);
+    if (io_.pread)
+      read_file(fd, static_cast<size_t>(pos));
+    else
+      handle_mmap(fd, static_cast<size_t>(pos));
+    return;
+  }
+  if (!spill_pipe(fd))
+    read_all(fd);
+}
+
+CsvReader::CsvReader(const char *file_name, const SeekIndex &index,
+                     size_t tail_rows) {
+  csv_fd = open(file_name, O_RDONLY);
+  if (csv_fd < 0)
+    throw std::runtime_error("Failed to open csv file");
+  try {
+    load_tail(index, tail_rows);
+  } catch (...) {
+    close(csv_fd);
+    throw;
+  }
+}
+
+// Non-blank rows in data, which starts at a row boundary
+static size_t count_tail_rows(const char *data, size_t len) {
+  size_t rows = 0;
+  size_t start = 0;
+  bool in_quotes = false;
+  for (size_t i = 0; i < len; ++i) {
+    if (data[i] == '"') {
+      in_quotes = !in_quotes;
+    } else if (data[i] == '\n' && !in_quotes) {
+      size_t end = (i > start && data[i - 1] == '\r') ? i - 1 : i;
+      rows += end > start;
+      start = i + 1;
+    }
+  }
+  return rows + (start < len);
+}
+
+// Decompresses [index.points[k].out, end) of the file
+static std::string decompress_range(int fd, const SeekIndex &index, size_t k,
+                                    uint64_t end) {
+  const SeekPoint &point = index.points[k];
+  std::string out(end - point.out, '\0');
+  auto decoder = Decompressor::open_at(fd, index.type, point);
+  size_t len = 0;
+  while (len < out.size())
+    if (size_t n = decoder->read(out.data() + len, out.size() - len))
+      len += n;
+    else
+      throw std::runtime_error("Compressed file changed since it was indexed");
+  return out;
+}
+
+// Walks back one seek point at a time, prepending each segment, until the
+// rows after the first row boundary are enough for the tail.
+void CsvReader::load_tail(const SeekIndex &index, size_t tail_rows) {
+  std::string header;
+  {
+    auto decoder = Decompressor::open_at(csv_fd, index.type,
+                                         index.points.front());
+    constexpr size_t kChunk = 1 << 16;
+    while (true) {
+      size_t old = header.size();
+      header.resize(old + kChunk);
+      size_t n = decoder->read(header.data() + old, kChunk);
+      header.resize(old + n);
+      size_t end = find_row_end(header.data(), header.size(), 0);
+      if (end < header.size() || n == 0) {
+        header.resize(std::min(end + 1, header.size()));
+        break;
+      }
+    }
+  }
+
+  std::string tail;
+  size_t skip = 0; // first row boundary in tail
+  size_t rows = 0; // rows from there on
+  uint64_t end = index.total_out;
+  for (size_t k = index.points.size(); k-- > 0;) {
+    const SeekPoint &point = index.points[k];
+    if (point.out == end)
+      continue;
+    std::string segment = decompress_range(csv_fd, index, k, end);
+    size_t seg_len = segment.size();
+    end = point.out;
+    tail.insert(0, segment);
+    // The old boundary (seg_len + skip) is still a row start, so only the
+    // rows before it are new
+    size_t old_skip = seg_len + skip;
+    if (k == 0)
+      skip = std::min(header.size(), old_skip);
+    else if (point.row_start)
+      skip = 0;
+    else
+      skip = std::min(find_row_end(tail.data(), old_skip, 0,
+                                   point.in_quotes) + 1,
+                      old_skip);
+    rows += count_tail_rows(tail.data() + skip, old_skip - skip);
+    if (rows >= tail_rows)
+      break;
+  }
+
+  stdin_buf_ = std::move(header);
+  if (!stdin_buf_.empty() && stdin_buf_.back() != '\n')
+    stdin_buf_ += '\n';
+  stdin_buf_.append(tail, skip, std::string::npos);
+  file_size_ = stdin_buf_.size();
+  addr = file_size_ > 0 ? stdin_buf_.data() : nullptr;
+  seek_total_ = static_cast<size_t>(index.total_out);
+}
+
+// Seekable input is peeked with pread. A pipe's first bytes have to be
+// consumed to be sniffed, so they are kept in peek_ and replayed in front
+// of the rest of the data.
+Compression CsvReader::detect_input(int fd) {
+  if (lseek(fd, 0, SEEK_CUR) >= 0)
+    return peek_compression(fd);
+  peek_.resize(kCompressionMagicBytes);
+  size_t len = 0;
+  bool eof = false;
+  while (len < peek_.size() && !eof)
+    len += read_some(fd, peek_.data() + len, peek_.size() - len, eof);
+  peek_.resize(len);
+  return detect_compression(peek_.data(), peek_.size());
+}
+
+void CsvReader::decompress_all(int fd, Compression c) {
+  try {
+    auto decoder = Decompressor::open(fd, c, peek_);
+    peek_.clear();
+    size_t len = 0;
+    stdin_buf_.resize(1 << 20);
+    while (size_t n = decoder->read(stdin_buf_.data() + len,
+                                    stdin_buf_.size() - len)) {
+      len += n;
+      if (len == stdin_buf_.size())
+        stdin_buf_.resize(stdin_buf_.size() * 2);
+    }
+    stdin_buf_.resize(len);
+    stdin_buf_.shrink_to_fit();
+  } catch (...) {
+    if (csv_fd >= 0)
+      close(csv_fd);
+    throw;
+  }
+  file_size_ = stdin_buf_.size();
+  addr = file_size_ > 0 ? stdin_buf_.data() : nullptr;
+}
+
+// Moves a pipe's contents into an anonymous memory file with splice, so the
+// bytes are never copied through user space or into a growing buffer, then
+// maps it. Returns false when fd cannot be spliced (not a pipe, or no
+// memfd support) and nothing has been consumed.
+bool CsvReader::spill_pipe(int fd) {
+#ifdef __linux__
+  int mfd = memfd_create("glance-stdin", MFD_CLOEXEC);
+  if (mfd < 0)
+    return false;
+
+  // Bytes already sniffed off the pipe go first
+  size_t total = 0;
+  if (!peek_.empty()) {
+    if (::write(mfd, peek_.data(), peek_.size()) !=
+        static_cast<ssize_t>(peek_.size())) {
+      close(mfd);
+      return false;
+    }
+    total = peek_.size();
+  }
+  size_t sniffed = total;
+  while (true) {
+    ssize_t n = splice(fd, nullptr, mfd, nullptr, 1 << 20, SPLICE_F_MOVE);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0 && total == sniffed &&
+        (errno == EINVAL || errno == ENOSYS)) {
+      close(mfd);
+      return false;
+    }
+    if (n < 0) {
+      close(mfd);
+      throw std::runtime_error("Failed to read stdin");
+    }
+    if (n == 0)
+      break;
+    total += static_cast<size_t>(n);
+  }
+  if (total == 0) {
+    close(mfd);
+    throw std::runtime_error("No data on stdin");
+  }
+
+  peek_.clear();
+  csv_fd = mfd;
+  file_size_ = total;
+  handle_mmap(csv_fd, 0);
+  return true;
+#else
+  (void)fd;
+  return false;
+#endif
+}
+
+CsvReader::CsvReader(int fd, size_t block_bytes, const IoOptions &io)
+    : io_(io), stream_fd_(fd) {
+  start_stream(block_bytes);
+}
+
+CsvReader::CsvReader(const char *file_name, size_t block_bytes,
+                     const IoOptions &io)
+    : io_(io) {
+  if (std::strcmp(file_name, "-") == 0) {
+    stream_fd_ = STDIN_FILENO;
+  } else {
+    csv_fd = open(file_name, O_RDONLY);
+    if (csv_fd < 0)
+      throw std::runtime_error("Failed to open csv file");
+    stream_fd_ = csv_fd;
+  }
+  try {
+    start_stream(block_bytes);
+  } catch (...) {
+    if (csv_fd >= 0)
+      close(csv_fd);
+    throw;
+  }
+}
+
+void CsvReader::start_stream(size_t block_bytes) {
+  block_bytes = std::max<size_t>(block_bytes, 1);
+  stdin_buf_.resize(block_bytes);
+  addr = stdin_buf_.data();
+  // Compressed input is always decompressed on the read-ahead thread
+  if (Compression c = detect_input(stream_fd_); c != Compression::None) {
+    std::shared_ptr<Decompressor> decoder =
+        Decompressor::open(stream_fd_, c, peek_);
+    peek_.clear();
+    read_ahead_ = std::make_unique<ReadAhead>(
+        [decoder](char *buf, size_t size) { return decoder->read(buf, size); },
+        block_bytes);
+  } else if (io_.pread) {
+    read_ahead_ =
+        std::make_unique<ReadAhead>(fd_source(stream_fd_), block_bytes);
+  }
+  if (!read_block())
+    throw std::runtime_error(stream_fd_ == STDIN_FILENO ? "No data on stdin"
+                                                        : "Empty csv file");
+}
+
+void CsvReader::read_all(int fd) {
+  // Read everything straight into a geometrically grown buffer, after any
+  // bytes already sniffed off the descriptor
+  size_t len = peek_.size();
+  bool eof = false;
+  stdin_buf_.resize(std::max<size_t>(1 << 16, len));
+  std::memcpy(stdin_buf_.data(), peek_.data(), len);
+  peek_.clear();
+  while (!eof) {
+    if (len == stdin_buf_.size())
+      stdin_buf_.resize(stdin_buf_.size() * 2);
+    len += read_some(fd, stdin_buf_.data() + len,
+                     stdin_buf_.size() - len, eof);
+  }
+  stdin_buf_.resize(len);
   if (stdin_buf_.empty())
     throw std::runtime_error("No data on stdin");
   file_size_ = stdin_buf_.size();
   addr = stdin_buf_.data();
 }
 
-void CsvReader::handle_mmap() {
-  this->addr =
-      mmap(nullptr, this->file_size_, PROT_READ, MAP_PRIVATE, this->csv_fd, 0);
-  if (this->addr == MAP_FAILED) {
-    close(this->csv_fd);
+size_t CsvReader::stream_read(char *buf, size_t size) {
+  if (!peek_.empty()) {
+    size_t n = std::min(size, peek_.size());
+    std::memcpy(buf, peek_.data(), n);
+    peek_.erase(0, n);
+    return n;
+  }
+  if (read_ahead_)
+    return read_ahead_->take(buf, size);
+  bool eof = false;
+  return read_some(stream_fd_, buf, size, eof);
+}
+
+bool CsvReader::read_block() {
+  if (stream_fd_ < 0)
+    return false;
+
+  bool first = stream_header_ == 0;
+  char *buf = stdin_buf_.data();
+
+  // Drop the rows handed out last time, moving the partial row that
+  // followed them up behind the header line
+  size_t carry = stream_filled_ - file_size_;
+  if (carry > 0 && file_size_ != stream_header_)
+    std::memmove(buf + stream_header_, buf + file_size_, carry);
+  stream_filled_ = stream_header_ + carry;
+  if (stream_eof_ && carry == 0)
+    return false;
+
+  // Fill the buffer, then cut after the last row end outside quotes. The
+  // scan resumes where it left off, so each byte is classified once.
+  constexpr size_t npos = static_cast<size_t>(-1);
+  size_t scan = stream_header_;
+  size_t last_end = npos;
+  bool in_quotes = false;
+  std::vector<size_t> ends;
+  while (!stream_eof_) {
+    if (stream_filled_ == stdin_buf_.size()) {
+      if (last_end != npos)
+        break;
+      // A row longer than the buffer: grow until it fits
+      stdin_buf_.resize(stdin_buf_.size() * 2);
+      buf = stdin_buf_.data();
+      addr = buf;
+    }
+    size_t n = stream_read(buf + stream_filled_,
+                           stdin_buf_.size() - stream_filled_);
+    stream_eof_ = n == 0;
+    stream_filled_ += n;
+    stream_bytes_ += n;
+    ends.clear();
+    in_quotes = find_row_ends(buf, scan, stream_filled_, in_quotes, ends);
+    scan = stream_filled_;
+    if (!ends.empty())
+      last_end = ends.back();
+  }
+
+  file_size_ = stream_eof_ ? stream_filled_ : last_end + 1;
+  if (first)
+    stream_header_ =
+        std::min(find_row_end(buf, file_size_, 0) + 1, file_size_);
+  return first ? file_size_ > 0 : file_size_ > stream_header_;
+}
+
+void CsvReader::advise(void *base, size_t len) const {
+  if (io_.sequential)
+    madvise(base, len, MADV_SEQUENTIAL);
+  if (io_.willneed)
+    madvise(base, len, MADV_WILLNEED);
+#ifdef MADV_HUGEPAGE
+  if (io_.hugepages)
+    madvise(base, len, MADV_HUGEPAGE);
+#endif
+}
+
+void CsvReader::handle_mmap(int fd, size_t offset) {
+  int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+  if (io_.populate)
+    flags |= MAP_POPULATE;
+#endif
+  // mmap offsets must be page-aligned; data() starts map_skip_ bytes in
+  size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  this->map_skip_ = offset % page;
+  void *base = mmap(nullptr, this->file_size_ + this->map_skip_, PROT_READ,
+                    flags, fd, static_cast<off_t>(offset - this->map_skip_));
+  if (base == MAP_FAILED) {
+    if (this->csv_fd >= 0)
+      close(this->csv_fd);
     throw std::runtime_error("Failed to MMAP file");
   }
+  advise(base, this->file_size_ + this->map_skip_);
+  this->addr = static_cast<char *>(base) + this->map_skip_;
+}
+
+// Reads the file into anonymous memory with large preads from a few
+// threads at once. On network filesystems this keeps several requests in
+// flight where faults on a mapping are serviced one page run at a time.
+void CsvReader::read_file(int fd, size_t offset) {
+  int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_POPULATE
+  if (io_.populate)
+    flags |= MAP_POPULATE;
+#endif
+  void *base = mmap(nullptr, file_size_, PROT_READ | PROT_WRITE, flags, -1, 0);
+  if (base == MAP_FAILED) {
+    if (csv_fd >= 0)
+      close(csv_fd);
+    throw std::runtime_error("Failed to allocate file buffer");
+  }
+#ifdef MADV_HUGEPAGE
+  if (io_.hugepages)
+    madvise(base, file_size_, MADV_HUGEPAGE);
+#endif
+
+  char *dst = static_cast<char *>(base);
+  size_t chunks = (file_size_ + kPreadChunkBytes - 1) / kPreadChunkBytes;
+  std::atomic<size_t> next{0};
+  try {
+    run_parallel(std::min(kPreadThreads, chunks), [&](size_t) {
+      for (size_t c; (c = next++) < chunks;) {
+        size_t begin = c * kPreadChunkBytes;
+        size_t len = std::min(kPreadChunkBytes, file_size_ - begin);
+        if (pread_full(fd, dst + begin, len,
+                       static_cast<off_t>(offset + begin)) != len)
+          throw std::runtime_error("File shrank while reading");
+      }
+    });
+  } catch (...) {
+    munmap(base, file_size_);
+    if (csv_fd >= 0)
+      close(csv_fd);
+    throw;
+  }
+  map_skip_ = 0;
+  addr = base;
 }
 
 CsvReader::~CsvReader() {
@@ -197,8 +806,8 @@ CsvReader::~CsvReader() {
     // stdin data owned by stdin_buf_, no munmap needed
     addr = nullptr;
   }
-  if (addr && addr != MAP_FAILED)
-    munmap(addr, file_size_);
+  if (addr)
+    munmap(static_cast<char *>(addr) - map_skip_, file_size_ + map_skip_);
   if (csv_fd >= 0)
     close(csv_fd);
 }
@@ -215,95 +824,573 @@ size_t CsvReader::parse_header(char delimiter) {
 
   headers_ = parse_line_fields(base, 0, actual_end, delimiter);
   ncols_ = headers_.size();
+  delim_ = delimiter;
+  body_ = (line_end < file_size_) ? line_end + 1 : file_size_;
+  return body_;
+}
 
-  return (line_end < file_size_) ? line_end + 1 : file_size_;
+// Scans the field starting at i and advances i past its delimiter.
+static inline std::string_view scan_field(const char *base, size_t &i,
+                                          size_t end, char delim) {
+  size_t fs = i;
+  if (base[i] == '"') {
+    ++i;
+    while (i < end) {
+      if (base[i] == '"') {
+        if (i + 1 < end && base[i + 1] == '"')
+          i += 2;
+        else
+          break;
+      } else
+        ++i;
+    }
+    if (i < end)
+      ++i; // closing quote
+    std::string_view field(base + fs, i - fs);
+    if (i < end && base[i] == delim)
+      ++i;
+    return field;
+  }
+  while (i < end && base[i] != delim)
+    ++i;
+  std::string_view field(base + fs, i - fs);
+  if (i < end)
+    ++i;
+  return field;
 }
 
 void CsvReader::append_row_fields(const char *base, size_t start, size_t end,
-                                  char delim) {
+                                  char delim,
+                                  std::vector<std::string_view> &out) const {
   size_t fields_added = 0;
   size_t i = start;
 
   while (i < end && fields_added < ncols_) {
-    if (base[i] == '"') {
-      size_t fs = i++;
-      while (i < end) {
-        if (base[i] == '"') {
-          if (i + 1 < end && base[i + 1] == '"')
-            i += 2;
-          else
-            break;
-        } else
-          ++i;
-      }
-      if (i < end)
-        ++i;
-      fields_.emplace_back(base + fs, i - fs);
-      ++fields_added;
-      if (i < end && base[i] == delim)
-        ++i;
-    } else {
-      size_t fs = i;
-      while (i < end && base[i] != delim)
-        ++i;
-      fields_.emplace_back(base + fs, i - fs);
-      ++fields_added;
-      if (i < end)
-        ++i;
-    }
+    out.push_back(scan_field(base, i, end, delim));
+    ++fields_added;
   }
 
   // Trailing delimiter → one more empty field
   if (fields_added < ncols_ && end > start && base[end - 1] == delim) {
-    fields_.emplace_back();
+    out.emplace_back();
     ++fields_added;
   }
 
   // Pad ragged rows
   while (fields_added < ncols_) {
-    fields_.emplace_back();
+    out.emplace_back();
     ++fields_added;
   }
 }
 
-size_t CsvReader::count_rows_from(size_t offset) const {
+std::string_view RowView::lazy_field(size_t i) const {
+  if (i < cursor_field_) {
+    cursor_field_ = 0;
+    cursor_pos_ = 0;
+  }
+  size_t pos = cursor_pos_;
+  for (size_t f = cursor_field_; pos < len_; ++f) {
+    size_t field_start = pos;
+    std::string_view v = scan_field(base_, pos, len_, delim_);
+    if (f == i) {
+      cursor_field_ = i;
+      cursor_pos_ = field_start;
+      return v;
+    }
+  }
+  // Trailing empty field or ragged-row padding
+  return {};
+}
+
+static constexpr size_t kMinChunkBytes = 1 << 20; // 1MB per thread
+static constexpr size_t kDropWindowBytes = 64 << 20;
+
+// Extends total by the counts of the range that follows it
+static void append_count(RowEndCount &total, const RowEndCount &next) {
+  total.outside +=
+      total.odd_quotes ? next.newlines - next.outside : next.outside;
+  total.newlines += next.newlines;
+  total.odd_quotes ^= next.odd_quotes;
+}
+
+// Each chunk is counted as if it started outside quotes; a sequential pass
+// over the chunk results then fixes up every chunk by its real quote state.
+static RowEndCount count_row_ends_parallel(const char *d, size_t len,
+                                           size_t threads) {
+  threads = std::min(threads, len / kMinChunkBytes);
+  if (threads <= 1)
+    return count_row_ends(d, len);
+
+  std::vector<RowEndCount> parts(threads);
+  size_t step = len / threads;
+  run_parallel(threads, [&](size_t t) {
+    size_t begin = step * t;
+    size_t end = (t + 1 == threads) ? len : begin + step;
+    parts[t] = count_row_ends(d + begin, end - begin);
+  });
+
+  RowEndCount total;
+  for (auto &p : parts)
+    append_count(total, p);
+  return total;
+}
+
+size_t CsvReader::count_rows_from(size_t offset, size_t threads,
+                                  bool *eof_in_quotes) const {
+  if (eof_in_quotes)
+    *eof_in_quotes = false;
   if (offset >= file_size_)
     return 0;
 
   const char *d = data() + offset;
   size_t len = file_size_ - offset;
-  if (len == 0)
-    return 0;
+  // Drop-behind releases each window's pages once counted, so a cold scan
+  // of a huge file does not grow the resident set. Only file-backed pages
+  // can be dropped: anonymous ones would read back as zeros.
+  bool drop = io_.drop_behind && !io_.pread && stdin_buf_.empty();
+  RowEndCount counts;
+  if (!drop) {
+    counts = count_row_ends_parallel(d, len, threads);
+  } else {
+    uintptr_t page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    for (size_t done = 0; done < len; done += kDropWindowBytes) {
+      size_t n = std::min(kDropWindowBytes, len - done);
+      append_count(counts, count_row_ends_parallel(d + done, n, threads));
+      // Only whole pages inside the window, so parsed rows stay resident
+      uintptr_t lo = reinterpret_cast<uintptr_t>(d + done) + page - 1;
+      uintptr_t hi = reinterpret_cast<uintptr_t>(d + done + n);
+      lo &= ~(page - 1);
+      hi &= ~(page - 1);
+      if (hi > lo)
+        madvise(reinterpret_cast<void *>(lo), hi - lo, MADV_DONTNEED);
+    }
+  }
+  if (eof_in_quotes)
+    *eof_in_quotes = counts.odd_quotes;
+  size_t count = counts.outside;
+  // If file doesn't end with \n, there's one more row
+  if (d[len - 1] != '\n')
+    ++count;
+  return count;
+}
+
+// --- Compact row storage ---
+
+static constexpr size_t kWindowBytes = 1 << 18; // 256KB per structural window
+
+void CsvReader::RowTable::clear() {
+  starts.clear();
+  ends.clear();
+  wide_rows.clear();
+  wide_fields.clear();
+}
 
-  // Fast path: no quotes in remainder → pure NEON newline count
-  if (!memchr(d, '"', len)) {
-    size_t nl = count_newlines(d, len);
-    // If file doesn't end with \n, there's one more row
-    if (d[len - 1] != '\n')
-      ++nl;
-    return nl;
+void CsvReader::store_row(RowTable &out, const char *row_start,
+                          size_t row_len,
+                          const std::vector<std::string_view> &fields) const {
+  size_t first = out.ends.size();
+  if (row_len >= RowView::kOffsetMask) {
+    out.wide_rows.push_back(out.starts.size());
+    out.starts.push_back(row_start);
+    out.ends.resize(first + ncols_, 0);
+    out.ends[first] = kWideRow;
+    out.wide_fields.insert(out.wide_fields.end(), fields.begin(),
+                           fields.end());
+    return;
   }
 
-  // Slow path: quote-aware
-  size_t count = 0;
+  out.starts.push_back(row_start);
+  uint32_t prev = 0;
+  for (size_t k = 0; k < ncols_; ++k) {
+    const std::string_view &f = fields[k];
+    uint32_t end = prev;
+    if (f.data()) {
+      auto fs = static_cast<uint32_t>(f.data() - row_start);
+      end = static_cast<uint32_t>(fs + f.size());
+      if (k > 0 && fs == prev)
+        out.ends[first + k - 1] |= RowView::kNoSeparator;
+    }
+    out.ends.push_back(end);
+    prev = end;
+  }
+}
+
+RowView CsvReader::wide_row(size_t i) const {
+  auto it = std::lower_bound(rows_.wide_rows.begin(), rows_.wide_rows.end(), i);
+  size_t w = static_cast<size_t>(it - rows_.wide_rows.begin());
+  if (lazy_) {
+    std::string_view span = rows_.wide_fields[w];
+    return {span.data(), span.size(), delim_, ncols_};
+  }
+  return {rows_.wide_fields.data() + w * ncols_, ncols_};
+}
+
+// Lazy mode: one length per row, no field offsets
+size_t CsvReader::index_rows(size_t begin, size_t limit, RowTable &out) const {
+  const char *base = data();
+  size_t total = file_size_;
+  size_t rows = 0;
+  size_t pos = begin;
   bool in_quotes = false;
-  for (size_t i = 0; i < len; ++i) {
-    if (d[i] == '"')
-      in_quotes = !in_quotes;
-    else if (!in_quotes && d[i] == '\n')
-      ++count;
+  std::vector<size_t> newlines;
+
+  auto emit = [&](size_t row_start, size_t row_end) {
+    size_t actual_end = row_end;
+    if (actual_end > row_start && base[actual_end - 1] == '\r')
+      --actual_end;
+    if (actual_end == row_start)
+      return;
+    size_t len = actual_end - row_start;
+    if (len >= RowView::kOffsetMask) {
+      out.wide_rows.push_back(out.starts.size());
+      out.ends.push_back(kWideRow);
+      out.wide_fields.emplace_back(base + row_start, len);
+    } else {
+      out.ends.push_back(static_cast<uint32_t>(len));
+    }
+    out.starts.push_back(base + row_start);
+    ++rows;
+  };
+
+  for (size_t scan = begin; scan < total && pos < limit;) {
+    size_t window_end = std::min(total, scan + kWindowBytes);
+    newlines.clear();
+    in_quotes = find_row_ends(base, scan, window_end, in_quotes, newlines);
+    for (size_t nl : newlines) {
+      if (pos >= limit)
+        break;
+      emit(pos, nl);
+      pos = nl + 1;
+    }
+    if (window_end == total && pos < limit) {
+      // Final row without a trailing newline
+      emit(pos, total);
+      pos = total;
+    }
+    scan = window_end;
   }
-  if (len > 0 && d[len - 1] != '\n')
-    ++count;
-  return count;
+  return rows;
 }
 
-void CsvReader::parse(char delimiter) {
+// Rows are tokenized from a structural index built one window at a time. A
+// row that crosses the end of a window is re-indexed at the start of the
+// next one; a row longer than a whole window goes through the scalar path.
+size_t CsvReader::parse_rows(size_t begin, size_t limit, char delim,
+                             RowTable &out) const {
+  const char *base = data();
+  size_t total = file_size_;
+  size_t rows = 0;
+  size_t pos = begin;
+  StructuralIndex index;
+  std::vector<std::string_view> scratch;
+  scratch.reserve(ncols_);
+
+  auto emit_scalar = [&](size_t row_start, size_t actual_end) {
+    scratch.clear();
+    append_row_fields(base, row_start, actual_end, delim, scratch);
+    store_row(out, base + row_start, actual_end - row_start, scratch);
+  };
+
+  // Emits the row [row_start, row_end) whose delimiters are sp[first, last)
+  auto emit_row = [&](size_t window, size_t row_start, size_t row_end,
+                      const std::vector<uint32_t> &sp, size_t first,
+                      size_t last) {
+    size_t actual_end = row_end;
+    if (actual_end > row_start && base[actual_end - 1] == '\r')
+      --actual_end;
+    if (actual_end == row_start)
+      return;
+    ++rows;
+
+    if (!index.clean(row_start - window, row_end - window)) {
+      emit_scalar(row_start, actual_end);
+      return;
+    }
+
+    out.starts.push_back(base + row_start);
+    size_t fields_added = 0;
+    uint32_t end = 0;
+    for (size_t k = first; k < last && fields_added < ncols_; ++k) {
+      end = static_cast<uint32_t>(window + sp[k] - row_start);
+      out.ends.push_back(end);
+      ++fields_added;
+    }
+    if (fields_added < ncols_) {
+      end = static_cast<uint32_t>(actual_end - row_start);
+      out.ends.push_back(end);
+      ++fields_added;
+    }
+    // Pad ragged rows with empty fields at the row end
+    for (; fields_added < ncols_; ++fields_added)
+      out.ends.push_back(end);
+  };
+
+  while (pos < limit) {
+    size_t window_end = std::min(total, pos + kWindowBytes);
+    index.build(base, pos, window_end, delim);
+    auto &sp = index.positions();
+
+    size_t row_start = pos;
+    size_t first = 0;
+    for (size_t k = 0; k < sp.size() && row_start < limit; ++k) {
+      size_t p = pos + sp[k];
+      if (base[p] != '\n')
+        continue;
+      emit_row(pos, row_start, p, sp, first, k);
+      row_start = p + 1;
+      first = k + 1;
+    }
+    if (window_end == total && row_start < limit) {
+      // Final row without a trailing newline
+      emit_row(pos, row_start, total, sp, first, sp.size());
+      row_start = total;
+    }
+
+    if (row_start == pos) {
+      // Row longer than the window
+      size_t line_end = find_line_end(base, total, pos);
+      size_t actual_end = line_end;
+      if (actual_end > pos && base[actual_end - 1] == '\r')
+        --actual_end;
+      if (actual_end > pos) {
+        emit_scalar(pos, actual_end);
+        ++rows;
+      }
+      row_start = (line_end < total) ? line_end + 1 : total;
+    }
+    pos = row_start;
+  }
+  return rows;
+}
+
+// --- Parallel parse ---
+//
+// Row boundaries are exactly the newlines preceded by an even number of
+// quotes, so the body is cut into equal byte ranges, each range's quote
+// parity is counted concurrently, and a prefix over those parities gives the
+// quote state at every cut. Each thread then starts at the first real row
+// boundary after its cut and tokenizes up to the next thread's start.
+
+void CsvReader::parse_parallel(size_t begin, char delim, size_t threads) {
+  const char *base = data();
+  size_t total = file_size_;
+  size_t body = total - begin;
+
+  std::vector<size_t> cuts(threads + 1);
+  for (size_t t = 0; t <= threads; ++t)
+    cuts[t] = begin + body / threads * t;
+  cuts[threads] = total;
+
+  // Pass 1: quote parity of every range
+  std::vector<uint8_t> parity(threads);
+  run_parallel(threads, [&](size_t t) {
+    parity[t] = count_byte(base + cuts[t], cuts[t + 1] - cuts[t], '"') & 1;
+  });
+
+  // Pass 2: first row start at or after each cut
+  std::vector<size_t> starts(threads + 1);
+  starts[0] = begin;
+  starts[threads] = total;
+  std::vector<uint8_t> in_quotes(threads, 0);
+  for (size_t t = 1; t < threads; ++t)
+    in_quotes[t] = in_quotes[t - 1] ^ parity[t - 1];
+
+  run_parallel(threads, [&](size_t t) {
+    if (t == 0)
+      return;
+    size_t i = find_row_end(base, total, cuts[t], in_quotes[t]);
+    starts[t] = (i < total) ? i + 1 : total;
+  });
+  for (size_t t = 1; t < threads; ++t)
+    starts[t] = std::max(starts[t], starts[t - 1]);
+
+  // Pass 3: tokenize (or, when lazy, only index) each range into
+  // thread-local storage
+  size_t stride = lazy_ ? 1 : ncols_;
+  size_t est_line_len = (begin > 0) ? begin : 50;
+  std::vector<RowTable> local(threads);
+  run_parallel(threads, [&](size_t t) {
+    size_t est_rows = (starts[t + 1] - starts[t]) / est_line_len + 1;
+    local[t].starts.reserve(est_rows);
+    local[t].ends.reserve(est_rows * stride);
+    if (lazy_)
+      index_rows(starts[t], starts[t + 1], local[t]);
+    else
+      parse_rows(starts[t], starts[t + 1], delim, local[t]);
+  });
+
+  // Pass 4: copy every range into its slot of the flat arrays
+  std::vector<size_t> row_offsets(threads + 1, 0);
+  for (size_t t = 0; t < threads; ++t)
+    row_offsets[t + 1] = row_offsets[t] + local[t].starts.size();
+  parsed_rows_ = row_offsets[threads];
+  rows_.starts.resize(parsed_rows_);
+  rows_.ends.resize(parsed_rows_ * stride);
+  run_parallel(threads, [&](size_t t) {
+    std::copy(local[t].starts.begin(), local[t].starts.end(),
+              rows_.starts.begin() +
+                  static_cast<ptrdiff_t>(row_offsets[t]));
+    std::copy(local[t].ends.begin(), local[t].ends.end(),
+              rows_.ends.begin() +
+                  static_cast<ptrdiff_t>(row_offsets[t] * stride));
+    std::vector<const char *>().swap(local[t].starts);
+    std::vector<uint32_t>().swap(local[t].ends);
+  });
+  for (size_t t = 0; t < threads; ++t) {
+    for (size_t r : local[t].wide_rows)
+      rows_.wide_rows.push_back(row_offsets[t] + r);
+    rows_.wide_fields.insert(rows_.wide_fields.end(),
+                             local[t].wide_fields.begin(),
+                             local[t].wide_fields.end());
+  }
+}
+
+void CsvReader::reset() {
   headers_.clear();
-  fields_.clear();
+  rows_.clear();
   parsed_rows_ = 0;
   total_rows_ = 0;
   ncols_ = 0;
+  body_ = 0;
+  lazy_ = false;
+  shards_.clear();
+  shard_bytes_ = 0;
+}
+
+// --- Sampling ---
+
+// Bodies up to this size are indexed and sampled exactly
+static constexpr size_t kExactSampleBytes = 4 << 20;
+// How far past a random offset to look for a quote that settles its state
+static constexpr size_t kResyncWindow = 1 << 16;
+
+static uint64_t splitmix64(uint64_t &state) {
+  uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  return z ^ (z >> 31);
+}
+
+// Quote state at an arbitrary offset. A quote that follows a separator and
+// precedes field text opens a field; one that follows text and precedes a
+// separator closes one. The first such quote after offset decides, after
+// accounting for the ambiguous single quotes passed on the way; "" pairs are
+// escapes or empty fields and never change the state. A quote right at
+// offset that follows another one is ambiguous too. No deciding quote in
+// the window means the offset is most likely outside quotes.
+static bool quoted_at(const char *base, size_t total, size_t offset,
+                      char delim) {
+  auto is_sep = [delim](char c) {
+    return c == delim || c == '\n' || c == '\r';
+  };
+  size_t limit = std::min(total, offset + kResyncWindow);
+  bool flipped = false;
+  size_t q = offset;
+  while (const void *hit = std::memchr(base + q, '"', limit - q)) {
+    q = static_cast<size_t>(static_cast<const char *>(hit) - base);
+    char next = q + 1 < total ? base[q + 1] : '\n';
+    if (next == '"') {
+      q += 2;
+      if (q >= limit)
+        break;
+      continue;
+    }
+    bool prev_sep = q == 0 || is_sep(base[q - 1]);
+    bool next_sep = is_sep(next);
+    // The quote before offset was never seen: it may pair with this one
+    bool unpaired = q > offset || q == 0 || base[q - 1] != '"';
+    if (prev_sep != next_sep && unpaired)
+      return next_sep != flipped; // closing: inside before q
+    flipped = !flipped;
+    if (++q >= limit)
+      break;
+  }
+  return false;
+}
+
+size_t CsvReader::row_after(size_t offset) const {
+  bool in_quotes = quoted_at(data(), file_size_, offset, delim_);
+  return find_row_end(data(), file_size_, offset, in_quotes) + 1;
+}
+
+// Walking back from offset flips the quote state at every quote, so the
+// first newline passed outside quotes ends the previous row.
+size_t CsvReader::row_containing(size_t offset) const {
+  const char *base = data();
+  bool in_quotes = quoted_at(base, file_size_, offset, delim_);
+  for (size_t p = offset; p > body_; --p) {
+    if (base[p - 1] == '"')
+      in_quotes = !in_quotes;
+    else if (base[p - 1] == '\n' && !in_quotes)
+      return p;
+  }
+  return body_;
+}
+
+size_t CsvReader::row_end_at(size_t start) const {
+  size_t end = find_row_end(data(), file_size_, start);
+  return (end > start && data()[end - 1] == '\r') ? end - 1 : end;
+}
+
+std::vector<std::string_view> CsvReader::stratified_rows(size_t n,
+                                                         uint64_t seed) const {
+  // Strata go to this reader and each appended shard in proportion to
+  // their body bytes; shard k draws with seed + k
+  std::vector<const CsvReader *> parts = {this};
+  for (auto &shard : shards_)
+    parts.push_back(shard.get());
+  auto body_bytes = [](const CsvReader *r) -> size_t {
+    return r->file_size_ > r->body_ ? r->file_size_ - r->body_ : 0;
+  };
+  size_t bytes = 0;
+  for (auto *part : parts)
+    bytes += body_bytes(part);
+
+  std::vector<std::string_view> rows;
+  size_t before = 0; // body bytes of the parts already drawn from
+  size_t given = 0;  // strata given to them
+  for (size_t k = 0; k < parts.size() && bytes > 0; ++k) {
+    before += body_bytes(parts[k]);
+    size_t upto = k + 1 == parts.size()
+                      ? n
+                      : static_cast<size_t>(static_cast<double>(n) *
+                                            static_cast<double>(before) /
+                                            static_cast<double>(bytes));
+    auto part = parts[k]->own_stratified_rows(upto - given, seed + k);
+    rows.insert(rows.end(), part.begin(), part.end());
+    given = upto;
+  }
+  return rows;
+}
+
+std::vector<std::string_view>
+CsvReader::own_stratified_rows(size_t n, uint64_t seed) const {
+  std::vector<std::string_view> rows;
+  size_t total = file_size_;
+  if (n == 0 || ncols_ == 0 || body_ >= total)
+    return rows;
+  size_t span = total - body_;
+  uint64_t state = seed;
+  size_t last = total;
+  for (size_t k = 0; k < n; ++k) {
+    size_t lo = body_ + span / n * k + span % n * k / n;
+    size_t hi = body_ + span / n * (k + 1) + span % n * (k + 1) / n;
+    if (lo >= hi)
+      continue;
+    // Strata ascend, so a repeat can only be of the previous row
+    size_t start = row_after(lo + splitmix64(state) % (hi - lo));
+    if (start >= total || start == last)
+      continue;
+    last = start;
+    size_t end = row_end_at(start);
+    if (end > start)
+      rows.emplace_back(data() + start, end - start);
+  }
+  return rows;
+}
+
+void CsvReader::parse_sample(char delimiter, size_t max_rows, uint64_t seed) {
+  reset();
 
   size_t pos = parse_header(delimiter);
   if (ncols_ == 0)
@@ -311,37 +1398,199 @@ void CsvReader::parse(char delimiter) {
 
   const char *base = data();
   size_t total = file_size_;
+  uint64_t state = seed;
 
-  // Pre-estimate rows to avoid reallocation
-  size_t est_line_len = (pos > 0) ? pos : 50;
-  size_t est_rows = (total > pos) ? (total - pos) / est_line_len + 1 : 0;
-  fields_.reserve(est_rows * ncols_);
+  std::vector<size_t> starts;
+  if (total - pos <= kExactSampleBytes) {
+    // Every non-blank row, then a partial Fisher-Yates shuffle
+    std::vector<size_t> newlines;
+    find_row_ends(base, pos, total, false, newlines);
+    newlines.push_back(total);
+    for (size_t i = 0, start = pos; start < total; start = newlines[i++] + 1) {
+      size_t end = newlines[i];
+      if (end > start && base[end - 1] == '\r')
+        --end;
+      if (end > start)
+        starts.push_back(start);
+    }
+    size_t take = std::min(max_rows, starts.size());
+    for (size_t i = 0; i < take; ++i) {
+      size_t j = i + splitmix64(state) % (starts.size() - i);
+      std::swap(starts[i], starts[j]);
+    }
+    starts.resize(take);
+  } else {
+    // The row each random offset falls in, so a row is drawn in proportion
+    // to its own length; repeats and blank rows are redrawn a bounded
+    // number of times
+    std::unordered_set<size_t> seen;
+    size_t attempts = 0;
+    while (starts.size() < max_rows && attempts++ < max_rows * 4 + 16) {
+      size_t start = row_containing(pos + splitmix64(state) % (total - pos));
+      if (start >= total || row_end_at(start) == start ||
+          !seen.insert(start).second)
+        continue;
+      starts.push_back(start);
+    }
+  }
+  std::sort(starts.begin(), starts.end());
 
-  while (pos < total) {
-    size_t line_end = find_line_end(base, total, pos);
-    size_t actual_end = line_end;
-    if (actual_end > pos && base[actual_end - 1] == '\r')
-      --actual_end;
+  std::vector<std::string_view> scratch;
+  scratch.reserve(ncols_);
+  rows_.starts.reserve(starts.size());
+  rows_.ends.reserve(starts.size() * ncols_);
+  for (size_t start : starts) {
+    size_t end = row_end_at(start);
+    scratch.clear();
+    append_row_fields(base, start, end, delimiter, scratch);
+    store_row(rows_, base + start, end - start, scratch);
+  }
+  parsed_rows_ = starts.size();
+  total_rows_ = starts.size();
+}
 
-    if (actual_end == pos) {
-      pos = (line_end < total) ? line_end + 1 : total;
-      continue;
-    }
+void CsvReader::append(std::vector<std::unique_ptr<CsvReader>> shards) {
+  for (auto &shard : shards) {
+    // Lazy rows are tokenized with this reader's delimiter
+    if (shard->ncols_ != ncols_ || shard->lazy_ != lazy_ ||
+        (lazy_ && shard->delim_ != delim_))
+      throw std::runtime_error("Cannot append a differently parsed reader");
+    size_t offset = parsed_rows_;
+    const RowTable &src = shard->rows_;
+    rows_.starts.insert(rows_.starts.end(), src.starts.begin(),
+                        src.starts.end());
+    rows_.ends.insert(rows_.ends.end(), src.ends.begin(), src.ends.end());
+    for (size_t w : src.wide_rows)
+      rows_.wide_rows.push_back(offset + w);
+    rows_.wide_fields.insert(rows_.wide_fields.end(), src.wide_fields.begin(),
+                             src.wide_fields.end());
+    parsed_rows_ += shard->parsed_rows_;
+    total_rows_ += shard->total_rows_;
+    shard_bytes_ += shard->input_size();
+    // Only the shard's bytes are still needed; drop its copy of the rows
+    shard->rows_ = RowTable{};
+    shards_.push_back(std::move(shard));
+  }
+}
 
-    append_row_fields(base, pos, actual_end, delimiter);
-    ++parsed_rows_;
-    pos = (line_end < total) ? line_end + 1 : total;
+void CsvReader::parse(char delimiter, size_t threads) {
+  reset();
+
+  size_t pos = parse_header(delimiter);
+  if (ncols_ == 0)
+    return;
+
+  size_t total = file_size_;
+  size_t body = total - pos;
+  threads = std::min(threads, body / kMinChunkBytes);
+
+  if (threads > 1) {
+    parse_parallel(pos, delimiter, threads);
+  } else {
+    // Pre-estimate rows to avoid reallocation
+    size_t est_line_len = (pos > 0) ? pos : 50;
+    size_t est_rows = (total > pos) ? (total - pos) / est_line_len + 1 : 0;
+    rows_.starts.reserve(est_rows);
+    rows_.ends.reserve(est_rows * ncols_);
+    parsed_rows_ = parse_rows(pos, total, delimiter, rows_);
   }
 
   total_rows_ = parsed_rows_;
 }
 
-void CsvReader::parse_head(char delimiter, size_t max_rows) {
-  headers_.clear();
-  fields_.clear();
-  parsed_rows_ = 0;
-  total_rows_ = 0;
-  ncols_ = 0;
+void CsvReader::parse_lazy(char delimiter, size_t threads) {
+  reset();
+
+  size_t pos = parse_header(delimiter);
+  if (ncols_ == 0)
+    return;
+  lazy_ = true;
+  delim_ = delimiter;
+
+  size_t total = file_size_;
+  threads = std::min(threads, (total - pos) / kMinChunkBytes);
+
+  if (threads > 1) {
+    parse_parallel(pos, delimiter, threads);
+  } else {
+    size_t est_line_len = (pos > 0) ? pos : 50;
+    size_t est_rows = (total > pos) ? (total - pos) / est_line_len + 1 : 0;
+    rows_.starts.reserve(est_rows);
+    rows_.ends.reserve(est_rows);
+    parsed_rows_ = index_rows(pos, total, rows_);
+  }
+
+  total_rows_ = parsed_rows_;
+}
+
+void CsvReader::load_lazy(char delimiter, const PackedRows &rows) {
+  reset();
+
+  size_t pos = parse_header(delimiter);
+  if (ncols_ == 0)
+    return;
+  lazy_ = true;
+  delim_ = delimiter;
+
+  // Packed lengths escape exactly where the row table's do, so they are
+  // the lazy row ends as stored
+  static_assert(PackedRows::kWide == kWideRow);
+  size_t n = rows.count;
+  rows_.ends.resize(n);
+  if (n > 0)
+    std::memcpy(rows_.ends.data(), rows.lengths, n * sizeof(uint32_t));
+  rows_.starts.resize(n);
+
+  const char *base = data();
+  uint64_t off = 0;
+  size_t w = 0;
+  auto mismatch = [] {
+    return std::runtime_error("Row index does not match the file");
+  };
+  for (size_t i = 0; i < n; ++i) {
+    uint32_t advance;
+    std::memcpy(&advance, rows.advances + i * sizeof(uint32_t),
+                sizeof(advance));
+    uint64_t len = rows_.ends[i];
+    bool wide = len == kWideRow;
+    if (advance == PackedRows::kWide || wide) {
+      uint64_t entry[3]; // row, offset, length
+      if (w == rows.wide_count)
+        throw mismatch();
+      std::memcpy(entry, rows.wide + w++ * sizeof(entry), sizeof(entry));
+      if (entry[0] != i || (!wide && entry[2] != len))
+        throw mismatch();
+      off = entry[1];
+      len = entry[2];
+    } else {
+      off += advance;
+    }
+    if ((!wide && len >= RowView::kOffsetMask) || off < pos ||
+        off > file_size_ || len > file_size_ - off)
+      throw mismatch();
+    rows_.starts[i] = base + off;
+    if (wide) {
+      rows_.wide_rows.push_back(i);
+      rows_.wide_fields.emplace_back(base + off, len);
+    }
+  }
+  if (w != rows.wide_count)
+    throw mismatch();
+
+  parsed_rows_ = n;
+  total_rows_ = n;
+}
+
+std::string_view CsvReader::row_span(size_t i) const {
+  uint32_t len = rows_.ends[i];
+  if (len != kWideRow)
+    return {rows_.starts[i], len};
+  auto it = std::lower_bound(rows_.wide_rows.begin(), rows_.wide_rows.end(), i);
+  return rows_.wide_fields[static_cast<size_t>(it - rows_.wide_rows.begin())];
+}
+
+void CsvReader::parse_head(char delimiter, size_t max_rows, size_t threads) {
+  reset();
 
   size_t pos = parse_header(delimiter);
   if (ncols_ == 0)
@@ -350,7 +1599,10 @@ void CsvReader::parse_head(char delimiter, size_t max_rows) {
   const char *base = data();
   size_t total = file_size_;
 
-  fields_.reserve(max_rows * ncols_);
+  rows_.starts.reserve(max_rows);
+  rows_.ends.reserve(max_rows * ncols_);
+  std::vector<std::string_view> scratch;
+  scratch.reserve(ncols_);
 
   while (pos < total && parsed_rows_ < max_rows) {
     size_t line_end = find_line_end(base, total, pos);
@@ -363,11 +1615,64 @@ void CsvReader::parse_head(char delimiter, size_t max_rows) {
       continue;
     }
 
-    append_row_fields(base, pos, actual_end, delimiter);
+    scratch.clear();
+    append_row_fields(base, pos, actual_end, delimiter, scratch);
+    store_row(rows_, base + pos, actual_end - pos, scratch);
     ++parsed_rows_;
     pos = (line_end < total) ? line_end + 1 : total;
   }
 
   // Count remaining rows without parsing them
-  total_rows_ = parsed_rows_ + count_rows_from(pos);
+  total_rows_ = parsed_rows_ + count_rows_from(pos, threads);
+}
+
+// The quote state before any byte is the parity of all quotes preceding it,
+// which is the parity at EOF with the quotes after it removed. The row count
+// pass also yields that parity, which lets the backward scan recognize real
+// row boundaries.
+void CsvReader::parse_tail(char delimiter, size_t max_rows, size_t threads) {
+  reset();
+
+  size_t pos = parse_header(delimiter);
+  if (ncols_ == 0)
+    return;
+
+  const char *base = data();
+  size_t total = file_size_;
+  bool in_quotes = false;
+  total_rows_ = count_rows_from(pos, threads, &in_quotes);
+
+  // Collect non-blank rows from the end, newest first
+  std::vector<std::pair<size_t, size_t>> rows;
+  auto take = [&](size_t start, size_t end) {
+    if (end > start && base[end - 1] == '\r')
+      --end;
+    if (end > start)
+      rows.emplace_back(start, end);
+  };
+
+  size_t row_end = total;
+  size_t i = total;
+  while (i > pos && rows.size() < max_rows) {
+    --i;
+    if (base[i] == '"') {
+      in_quotes = !in_quotes;
+    } else if (base[i] == '\n' && !in_quotes) {
+      take(i + 1, row_end);
+      row_end = i;
+    }
+  }
+  if (i == pos && rows.size() < max_rows)
+    take(pos, row_end);
+
+  std::vector<std::string_view> scratch;
+  scratch.reserve(ncols_);
+  rows_.starts.reserve(rows.size());
+  rows_.ends.reserve(rows.size() * ncols_);
+  for (auto it = rows.rbegin(); it != rows.rend(); ++it) {
+    scratch.clear();
+    append_row_fields(base, it->first, it->second, delimiter, scratch);
+    store_row(rows_, base + it->first, it->second - it->first, scratch);
+  }
+  parsed_rows_ = rows.size();
 }
@@ -0,0 +1,559 @@
+#include "include/decompress.hpp"
+#include "include/parallel.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#ifdef GLANCE_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef GLANCE_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+Compression detect_compression(const char *data, size_t len) {
+  auto *p = reinterpret_cast<const unsigned char *>(data);
+  if (len >= 2 && p[0] == 0x1f && p[1] == 0x8b)
+    return Compression::Gzip;
+  if (len >= 4 && p[0] == 0x28 && p[1] == 0xb5 && p[2] == 0x2f &&
+      p[3] == 0xfd)
+    return Compression::Zstd;
+  return Compression::None;
+}
+
+Compression peek_compression(int fd) {
+  off_t pos = lseek(fd, 0, SEEK_CUR);
+  if (pos < 0)
+    return Compression::None;
+  char magic[kCompressionMagicBytes];
+  ssize_t n = pread(fd, magic, sizeof(magic), pos);
+  if (n <= 0)
+    return Compression::None;
+  return detect_compression(magic, static_cast<size_t>(n));
+}
+
+namespace {
+
+constexpr size_t kInputBytes = 1 << 18; // compressed bytes per refill
+constexpr size_t kWindowBytes = 1 << 15; // deflate's back-reference limit
+
+void seek_to(int fd, uint64_t offset) {
+  if (lseek(fd, static_cast<off_t>(offset), SEEK_SET) < 0)
+    throw std::runtime_error("Compressed input is not seekable");
+}
+
+// CSV quote state across decompressed output, so seek points can say
+// whether they fall inside a quoted field and where the next row starts.
+struct QuoteState {
+  bool in_quotes = false;
+  char last = '\n';
+
+  void feed(const char *data, size_t len) {
+    if (len == 0)
+      return;
+    const char *end = data + len;
+    for (const char *p = data;
+         (p = static_cast<const char *>(std::memchr(p, '"', end - p)));
+         ++p)
+      in_quotes = !in_quotes;
+    last = end[-1];
+  }
+
+  SeekPoint point(uint64_t out, uint64_t in) const {
+    SeekPoint p;
+    p.out = out;
+    p.in = in;
+    p.in_quotes = in_quotes;
+    p.row_start = !in_quotes && last == '\n';
+    return p;
+  }
+};
+
+// Compressed bytes: the sniffed prefix first, then the descriptor.
+class Input {
+  int fd_;
+  std::string prefix_;
+  size_t prefix_pos_ = 0;
+
+public:
+  Input(int fd, std::string_view prefix) : fd_(fd), prefix_(prefix) {}
+
+  // Reads up to size bytes; returns 0 only at the end of input.
+  size_t read(char *dst, size_t size) {
+    if (prefix_pos_ < prefix_.size()) {
+      size_t n = std::min(size, prefix_.size() - prefix_pos_);
+      std::memcpy(dst, prefix_.data() + prefix_pos_, n);
+      prefix_pos_ += n;
+      return n;
+    }
+    while (true) {
+      ssize_t n = ::read(fd_, dst, size);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n < 0)
+        throw std::runtime_error("Failed to read compressed input");
+      return static_cast<size_t>(n);
+    }
+  }
+};
+
+#ifdef GLANCE_HAVE_ZLIB
+class GzipDecompressor : public Decompressor {
+  Input in_;
+  std::vector<char> buf_;
+  z_stream zs_{};
+  bool raw_ = false; // resumed mid-member: no header, trailer still ahead
+  bool done_ = false;
+
+  bool refill() {
+    size_t n = in_.read(buf_.data(), buf_.size());
+    zs_.next_in = reinterpret_cast<Bytef *>(buf_.data());
+    zs_.avail_in = static_cast<uInt>(n);
+    return n > 0;
+  }
+
+  // Skips the CRC and size that close the member a raw decode resumed in
+  void skip_trailer() {
+    for (size_t left = 8; left > 0;) {
+      if (zs_.avail_in == 0 && !refill())
+        throw std::runtime_error("Truncated gzip input");
+      uInt n = static_cast<uInt>(std::min<size_t>(left, zs_.avail_in));
+      zs_.next_in += n;
+      zs_.avail_in -= n;
+      left -= n;
+    }
+  }
+
+public:
+  GzipDecompressor(int fd, std::string_view prefix)
+      : in_(fd, prefix), buf_(kInputBytes) {
+    // 16 + MAX_WBITS: gzip wrapper only
+    if (inflateInit2(&zs_, 16 + MAX_WBITS) != Z_OK)
+      throw std::runtime_error("Failed to initialize gzip decoder");
+  }
+
+  // Raw deflate from a block boundary, primed with the partial byte and the
+  // window that precede it
+  GzipDecompressor(int fd, const SeekPoint &point)
+      : in_(fd, {}), buf_(kInputBytes), raw_(true) {
+    if (inflateInit2(&zs_, -MAX_WBITS) != Z_OK)
+      throw std::runtime_error("Failed to initialize gzip decoder");
+    seek_to(fd, point.in - (point.bits ? 1 : 0));
+    if (point.bits) {
+      unsigned char byte = 0;
+      if (in_.read(reinterpret_cast<char *>(&byte), 1) != 1)
+        throw std::runtime_error("Truncated gzip input");
+      inflatePrime(&zs_, point.bits, byte >> (8 - point.bits));
+    }
+    inflateSetDictionary(
+        &zs_, reinterpret_cast<const Bytef *>(point.window.data()),
+        static_cast<uInt>(point.window.size()));
+  }
+  ~GzipDecompressor() override { inflateEnd(&zs_); }
+
+  size_t read(char *dst, size_t size) override {
+    size_t produced = 0;
+    while (produced < size && !done_) {
+      zs_.next_out = reinterpret_cast<Bytef *>(dst + produced);
+      zs_.avail_out = static_cast<uInt>(
+          std::min<size_t>(size - produced, 1u << 30));
+      int ret = inflate(&zs_, Z_NO_FLUSH);
+      produced = static_cast<size_t>(reinterpret_cast<char *>(zs_.next_out) -
+                                     dst);
+      if (ret == Z_STREAM_END) {
+        // Concatenated members (as written by pigz or 'cat a.gz b.gz')
+        // continue the stream; anything else after a member ends it
+        if (raw_)
+          skip_trailer();
+        if (zs_.avail_in == 0 && !refill()) {
+          done_ = true;
+        } else if (static_cast<unsigned char>(*zs_.next_in) != 0x1f) {
+          done_ = true;
+        } else if (raw_) {
+          inflateReset2(&zs_, 16 + MAX_WBITS);
+          raw_ = false;
+        } else {
+          inflateReset(&zs_);
+        }
+      } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+        throw std::runtime_error("Corrupt gzip input");
+      } else if (zs_.avail_in == 0 && produced < size && !refill()) {
+        // inflate had room but ran out of input inside a member
+        throw std::runtime_error("Truncated gzip input");
+      }
+    }
+    return produced;
+  }
+};
+#endif
+
+#ifdef GLANCE_HAVE_ZSTD
+class ZstdDecompressor : public Decompressor {
+  Input in_;
+  std::vector<char> buf_;
+  ZSTD_DCtx *ctx_;
+  ZSTD_inBuffer zin_{nullptr, 0, 0};
+  // Hint from the last call that made progress; 0 once a frame is done
+  size_t pending_ = 0;
+  bool eof_ = false;   // all input consumed; the decoder may still flush
+  bool done_ = false;
+
+public:
+  ZstdDecompressor(int fd, std::string_view prefix)
+      : in_(fd, prefix), buf_(ZSTD_DStreamInSize()), ctx_(ZSTD_createDCtx()) {
+    if (!ctx_)
+      throw std::runtime_error("Failed to initialize zstd decoder");
+  }
+  ~ZstdDecompressor() override { ZSTD_freeDCtx(ctx_); }
+
+  size_t read(char *dst, size_t size) override {
+    ZSTD_outBuffer out{dst, size, 0};
+    while (out.pos < out.size && !done_) {
+      if (zin_.pos == zin_.size && !eof_) {
+        size_t n = in_.read(buf_.data(), buf_.size());
+        eof_ = n == 0;
+        zin_ = {buf_.data(), n, 0};
+      }
+      // Past the end of input the decoder is called with nothing new until
+      // it stops producing the output it still holds
+      size_t before = out.pos;
+      size_t hint = ZSTD_decompressStream(ctx_, &out, &zin_);
+      if (ZSTD_isError(hint))
+        throw std::runtime_error("Corrupt zstd input");
+      if (out.pos != before || !eof_) {
+        pending_ = hint;
+      } else {
+        if (pending_ != 0)
+          throw std::runtime_error("Truncated zstd input");
+        done_ = true;
+      }
+    }
+    return out.pos;
+  }
+};
+#endif
+
+#ifdef GLANCE_HAVE_ZLIB
+// zran: inflate one block at a time (Z_BLOCK) into a circular 32 KB window;
+// whenever a block ends at least span bytes past the last point, snapshot
+// the bit position and the window.
+SeekIndex build_gzip_index(int fd, uint64_t span) {
+  seek_to(fd, 0);
+  Input in(fd, {});
+  std::vector<char> buf(kInputBytes);
+  std::vector<char> window(kWindowBytes);
+  z_stream zs{};
+  if (inflateInit2(&zs, 16 + MAX_WBITS) != Z_OK)
+    throw std::runtime_error("Failed to initialize gzip decoder");
+  struct End {
+    z_stream *zs;
+    ~End() { inflateEnd(zs); }
+  } end{&zs};
+
+  SeekIndex index;
+  index.type = Compression::Gzip;
+  index.points.emplace_back();
+  QuoteState quotes;
+  uint64_t total_in = 0, total_out = 0, last = 0;
+  bool eof = false;
+  while (true) {
+    if (zs.avail_in == 0 && !eof) {
+      size_t n = in.read(buf.data(), buf.size());
+      eof = n == 0;
+      zs.next_in = reinterpret_cast<Bytef *>(buf.data());
+      zs.avail_in = static_cast<uInt>(n);
+    }
+    if (zs.avail_out == 0) {
+      zs.next_out = reinterpret_cast<Bytef *>(window.data());
+      zs.avail_out = static_cast<uInt>(window.size());
+    }
+    auto *before = reinterpret_cast<char *>(zs.next_out);
+    uInt avail_in = zs.avail_in;
+    int ret = inflate(&zs, Z_BLOCK);
+    size_t produced = static_cast<size_t>(
+        reinterpret_cast<char *>(zs.next_out) - before);
+    total_in += avail_in - zs.avail_in;
+    total_out += produced;
+    quotes.feed(before, produced);
+
+    if (ret == Z_STREAM_END) {
+      if (zs.avail_in == 0 && !eof) {
+        size_t n = in.read(buf.data(), buf.size());
+        eof = n == 0;
+        zs.next_in = reinterpret_cast<Bytef *>(buf.data());
+        zs.avail_in = static_cast<uInt>(n);
+      }
+      if (zs.avail_in == 0 || static_cast<unsigned char>(*zs.next_in) != 0x1f)
+        break;
+      inflateReset(&zs);
+      continue;
+    }
+    if (ret == Z_BUF_ERROR && eof)
+      throw std::runtime_error("Truncated gzip input");
+    if (ret != Z_OK && ret != Z_BUF_ERROR)
+      throw std::runtime_error("Corrupt gzip input");
+
+    // Bit 7: at a block boundary; bit 6: that was the member's last block
+    bool boundary = (zs.data_type & 128) && !(zs.data_type & 64);
+    if (boundary && total_out - last >= span) {
+      SeekPoint point = quotes.point(total_out, total_in);
+      point.bits = static_cast<uint8_t>(zs.data_type & 7);
+      size_t pos = window.size() - zs.avail_out; // oldest byte once full
+      if (total_out >= window.size())
+        point.window.assign(window.data() + pos, window.size() - pos);
+      point.window.append(window.data(), pos);
+      index.points.push_back(std::move(point));
+      last = total_out;
+    }
+  }
+  index.total_out = total_out;
+  return index;
+}
+#endif
+
+#ifdef GLANCE_HAVE_ZSTD
+// Decodes everything read yields, passing each chunk of output to emit
+// with whether a frame ended there and the compressed bytes consumed.
+// ZSTD_decompressStream returns 0 exactly when a frame has been decoded
+// and flushed, so every frame end is a candidate point.
+template <typename Read, typename Emit>
+void drain_zstd(Read &&read, Emit &&emit) {
+  std::vector<char> buf(ZSTD_DStreamInSize());
+  std::vector<char> out_buf(ZSTD_DStreamOutSize());
+  ZSTD_DCtx *ctx = ZSTD_createDCtx();
+  if (!ctx)
+    throw std::runtime_error("Failed to initialize zstd decoder");
+  struct End {
+    ZSTD_DCtx *ctx;
+    ~End() { ZSTD_freeDCtx(ctx); }
+  } end{ctx};
+
+  ZSTD_inBuffer zin{nullptr, 0, 0};
+  uint64_t read_in = 0;
+  size_t pending = 0;
+  while (true) {
+    if (zin.pos == zin.size) {
+      size_t n = read(buf.data(), buf.size());
+      read_in += n;
+      zin = {buf.data(), n, 0};
+    }
+    // At the end of input, flush until the decoder has nothing left
+    ZSTD_outBuffer out{out_buf.data(), out_buf.size(), 0};
+    size_t hint = ZSTD_decompressStream(ctx, &out, &zin);
+    if (ZSTD_isError(hint))
+      throw std::runtime_error("Corrupt zstd input");
+    if (out.pos == 0 && zin.size == 0) {
+      if (pending != 0)
+        throw std::runtime_error("Truncated zstd input");
+      return;
+    }
+    pending = hint;
+    emit(out_buf.data(), out.pos, pending == 0,
+         read_in - (zin.size - zin.pos));
+  }
+}
+
+// One frame as listed by a seekable-format seek table.
+struct ZstdFrame {
+  uint64_t in = 0; // compressed offset
+  uint32_t in_size = 0;
+  uint32_t out_size = 0;
+};
+
+constexpr uint32_t kSeekTableMagic = 0x184D2A5E; // a skippable frame
+constexpr uint32_t kSeekableMagic = 0x8F92EAB1;  // closes its footer
+constexpr size_t kSeekTableFooterBytes = 9;
+
+uint32_t load_le32(const unsigned char *p) {
+  return p[0] | p[1] << 8 | p[2] << 16 | static_cast<uint32_t>(p[3]) << 24;
+}
+
+bool pread_exact(int fd, void *dst, size_t size, uint64_t offset) {
+  auto *p = static_cast<char *>(dst);
+  while (size > 0) {
+    ssize_t n = ::pread(fd, p, size, static_cast<off_t>(offset));
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    p += n;
+    size -= static_cast<size_t>(n);
+    offset += static_cast<uint64_t>(n);
+  }
+  return true;
+}
+
+// The frames of a file in the seekable format: a skippable frame at the
+// end lists each frame's compressed and decompressed size, then a footer
+// of frame count, descriptor and magic. Empty when the file does not end
+// in a table that accounts for every byte before it.
+std::vector<ZstdFrame> read_seek_table(int fd) {
+  struct stat sbuf;
+  if (fstat(fd, &sbuf) != 0 || !S_ISREG(sbuf.st_mode))
+    return {};
+  auto size = static_cast<uint64_t>(sbuf.st_size);
+  unsigned char footer[kSeekTableFooterBytes];
+  if (size < 8 + sizeof(footer) ||
+      !pread_exact(fd, footer, sizeof(footer), size - sizeof(footer)) ||
+      load_le32(footer + 5) != kSeekableMagic || (footer[4] & 0x7c) != 0)
+    return {};
+
+  uint64_t count = load_le32(footer);
+  size_t entry = (footer[4] & 0x80) ? 12 : 8; // with a checksum per frame
+  uint64_t table = count * entry + sizeof(footer);
+  if (table + 8 > size)
+    return {};
+  std::vector<unsigned char> buf(table + 8);
+  if (!pread_exact(fd, buf.data(), buf.size(), size - buf.size()) ||
+      load_le32(buf.data()) != kSeekTableMagic ||
+      load_le32(buf.data() + 4) != table)
+    return {};
+
+  std::vector<ZstdFrame> frames(count);
+  uint64_t in = 0;
+  for (size_t k = 0; k < count; ++k) {
+    const unsigned char *e = buf.data() + 8 + k * entry;
+    frames[k] = {in, load_le32(e), load_le32(e + 4)};
+    in += frames[k].in_size;
+  }
+  if (in != size - buf.size())
+    return {};
+  return frames;
+}
+
+// With a seek table the frames are decoded independently on a pool of
+// threads, each only for its quote parity and last byte; the points then
+// go on the frame starts, as a sequential scan would put them.
+SeekIndex build_zstd_index(int fd, uint64_t span, size_t threads) {
+  SeekIndex index;
+  index.type = Compression::Zstd;
+  index.points.emplace_back();
+
+  std::vector<ZstdFrame> frames = read_seek_table(fd);
+  if (frames.empty()) {
+    seek_to(fd, 0);
+    Input in(fd, {});
+    QuoteState quotes;
+    uint64_t total_out = 0, last = 0;
+    drain_zstd([&](char *dst, size_t size) { return in.read(dst, size); },
+               [&](const char *data, size_t len, bool frame_end,
+                   uint64_t consumed) {
+                 total_out += len;
+                 quotes.feed(data, len);
+                 if (frame_end && total_out - last >= span) {
+                   index.points.push_back(quotes.point(total_out, consumed));
+                   last = total_out;
+                 }
+               });
+    // A point at the very end (after the last frame, or a skippable frame
+    // such as a seek table) resumes nothing
+    if (index.points.size() > 1 && index.points.back().out == total_out)
+      index.points.pop_back();
+    index.total_out = total_out;
+    return index;
+  }
+
+  std::vector<QuoteState> states(frames.size());
+  std::atomic<size_t> next{0};
+  run_parallel(std::min(threads, frames.size()), [&](size_t) {
+    for (size_t k; (k = next++) < frames.size();) {
+      const ZstdFrame &f = frames[k];
+      uint64_t offset = 0, produced = 0;
+      drain_zstd(
+          [&](char *dst, size_t size) {
+            size_t n = std::min<uint64_t>(size, f.in_size - offset);
+            if (!pread_exact(fd, dst, n, f.in + offset))
+              throw std::runtime_error("Failed to read compressed input");
+            offset += n;
+            return n;
+          },
+          [&](const char *data, size_t len, bool, uint64_t) {
+            produced += len;
+            states[k].feed(data, len);
+          });
+      if (produced != f.out_size)
+        throw std::runtime_error("Corrupt zstd input");
+    }
+  });
+
+  QuoteState quotes;
+  uint64_t out = 0, last = 0;
+  for (size_t k = 0; k < frames.size(); ++k) {
+    if (k > 0 && out - last >= span) {
+      index.points.push_back(quotes.point(out, frames[k].in));
+      last = out;
+    }
+    quotes.in_quotes ^= states[k].in_quotes;
+    if (frames[k].out_size > 0)
+      quotes.last = states[k].last;
+    out += frames[k].out_size;
+  }
+  index.total_out = out;
+  return index;
+}
+#endif
+
+} // namespace
+
+SeekIndex build_seek_index(int fd, Compression c, uint64_t span,
+                           size_t threads) {
+  (void)threads; // only zstd seek tables are decoded in parallel
+  switch (c) {
+  case Compression::Gzip:
+#ifdef GLANCE_HAVE_ZLIB
+    return build_gzip_index(fd, span);
+#else
+    throw std::runtime_error("gzip input needs a build with zlib");
+#endif
+  case Compression::Zstd:
+#ifdef GLANCE_HAVE_ZSTD
+    return build_zstd_index(fd, span, threads);
+#else
+    throw std::runtime_error("zstd input needs a build with libzstd");
+#endif
+  case Compression::None:
+    break;
+  }
+  throw std::runtime_error("Input is not compressed");
+}
+
+std::unique_ptr<Decompressor> Decompressor::open(int fd, Compression c,
+                                                 std::string_view prefix) {
+  switch (c) {
+  case Compression::Gzip:
+#ifdef GLANCE_HAVE_ZLIB
+    return std::make_unique<GzipDecompressor>(fd, prefix);
+#else
+    throw std::runtime_error("gzip input needs a build with zlib");
+#endif
+  case Compression::Zstd:
+#ifdef GLANCE_HAVE_ZSTD
+    return std::make_unique<ZstdDecompressor>(fd, prefix);
+#else
+    throw std::runtime_error("zstd input needs a build with libzstd");
+#endif
+  case Compression::None:
+    break;
+  }
+  throw std::runtime_error("Input is not compressed");
+}
+
+std::unique_ptr<Decompressor> Decompressor::open_at(int fd, Compression c,
+                                                    const SeekPoint &point) {
+  if (point.out == 0 || c != Compression::Gzip) {
+    // The start of the file, or a zstd frame boundary: a fresh decoder
+    seek_to(fd, point.in);
+    return open(fd, c);
+  }
+#ifdef GLANCE_HAVE_ZLIB
+  return std::make_unique<GzipDecompressor>(fd, point);
+#else
+  throw std::runtime_error("gzip input needs a build with zlib");
+#endif
+}
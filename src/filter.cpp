@@ -1,13 +1,27 @@
 #include "include/filter.hpp"
+#include "include/columns.hpp"
 #include "include/csv_reader.hpp"
+#include "include/numeric.hpp"
+#include "include/parallel.hpp"
+#include "include/text_search.hpp"
 #include <algorithm>
+#include <bit>
+#include <cmath>
 #include <cstdint>
-#include <cstdlib>
+#include <limits>
 #include <numeric>
-#include <span>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <type_traits>
+
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 static std::string_view trim(std::string_view s) {
   while (!s.empty() && s.front() == ' ')
@@ -17,11 +31,15 @@ static std::string_view trim(std::string_view s) {
   return s;
 }
 
+static char fold(char c) {
+  return static_cast<char>(c >= 'A' && c <= 'Z' ? c + 32 : c);
+}
+
 static std::string to_lower(std::string_view s) {
   std::string result;
   result.reserve(s.size());
   for (char c : s)
-    result += static_cast<char>(c >= 'A' && c <= 'Z' ? c + 32 : c);
+    result += fold(c);
   return result;
 }
 
@@ -44,6 +62,7 @@ static constexpr WordOpToken word_op_tokens[] = {
     {"starts_with", FilterOp::StartsWith},
     {"ends_with", FilterOp::EndsWith},
     {"contains", FilterOp::Contains},
+    {"in", FilterOp::In},
 };
 
 Filter parse_filter(std::string_view expr) {
@@ -72,11 +91,25 @@ Filter parse_filter(std::string_view expr) {
     if (pos != std::string_view::npos) {
       auto col = trim(nexpr.substr(0, pos));
       auto val = trim(nexpr.substr(pos + search.size()));
+      // "note == sign in" compares against a value containing " in ",
+      // and "time in ms > 4" names a column containing it
+      if (wop.op == FilterOp::In &&
+          std::any_of(std::begin(op_tokens), std::end(op_tokens),
+                      [&](const OpToken &op) {
+                        return nexpr.find(op.token) != std::string_view::npos;
+                      }))
+        continue;
       if (col.empty() || val.empty())
         throw std::runtime_error(
             "Invalid filter: column and value required around '" +
             std::string(wop.token) + "'");
-      return {std::string(col), wop.op, std::string(val)};
+      // An In list keeps its quotes for in_values to split around
+      if (wop.op != FilterOp::In)
+        val = strip_quotes(val);
+      Filter f{std::string(col), wop.op, std::string(val)};
+      if (wop.op == FilterOp::In && in_values(f).empty())
+        throw std::runtime_error("Invalid filter: no values after 'in'");
+      return f;
     }
   }
 
@@ -89,25 +122,234 @@ Filter parse_filter(std::string_view expr) {
         throw std::runtime_error(
             "Invalid filter: column and value required around '" +
             std::string(op.token) + "'");
-      return {std::string(col), op.op, std::string(val)};
+      return {std::string(col), op.op, std::string(strip_quotes(val))};
     }
   }
 
   throw std::runtime_error("No valid operator found in filter: '" +
                            std::string(nexpr) + "'\n"
                            "Supported: ==, !=, >, <, >=, <=, contains, "
-                           "starts_with, ends_with");
+                           "starts_with, ends_with, in");
 }
 
-static double parse_numeric(const std::string &s) {
-  std::string cleaned;
-  cleaned.reserve(s.size());
-  for (char c : s) {
-    if (c == '$' || c == ',')
+std::vector<std::string> in_values(const Filter &filter) {
+  std::vector<std::string> values;
+  std::string_view val = filter.value;
+  size_t start = 0;
+  bool quoted = false;
+  for (size_t i = 0; i <= val.size(); ++i) {
+    if (i < val.size() && val[i] == '"')
+      quoted = !quoted;
+    if (i < val.size() && (quoted || val[i] != ','))
       continue;
-    cleaned += c;
+    auto item = strip_quotes(trim(val.substr(start, i - start)));
+    if (!item.empty())
+      values.emplace_back(item);
+    start = i + 1;
   }
-  return std::stod(cleaned);
+  return values;
+}
+
+// --- Expressions ---
+
+namespace {
+// Comparisons that did not parse, as opposed to a malformed expression.
+// mixed: a part other than the first did parse, so the string is not one
+// comparison either.
+struct ComparisonError : std::runtime_error {
+  bool mixed;
+  ComparisonError(const std::string &what, bool mixed)
+      : std::runtime_error(what), mixed(mixed) {}
+};
+
+// Recursive descent over or, and, not and parentheses; everything else
+// is comparison text for parse_filter
+class ExprParser {
+public:
+  explicit ExprParser(std::string_view s) : s_(s) {}
+
+  // Reads on past a comparison that does not parse, to tell a value
+  // containing and/or from a mix of comparisons and stray text
+  FilterExpr parse() {
+    FilterExpr e;
+    try {
+      e = parse_or();
+      skip_space();
+      if (pos_ < s_.size())
+        throw std::runtime_error("Invalid filter: unexpected '" +
+                                 std::string(s_.substr(pos_)) + "'");
+    } catch (const std::runtime_error &) {
+      if (error_.empty())
+        throw;
+    }
+    // A string with not or parentheses is no single comparison either
+    if (!error_.empty() && structured_ && !mixed_)
+      throw std::runtime_error(error_);
+    if (!error_.empty())
+      throw ComparisonError(error_, mixed_);
+    return e;
+  }
+
+private:
+  std::string_view s_;
+  size_t pos_ = 0;
+  size_t depth_ = 0; // open parentheses
+  size_t parts_ = 0;  // comparisons read
+  std::string error_; // the first that did not parse
+  bool mixed_ = false;
+  bool structured_ = false; // read a not or a group
+
+  static bool is_space(char c) { return c == ' ' || c == '\t'; }
+
+  void skip_space() {
+    while (pos_ < s_.size() && is_space(s_[pos_]))
+      ++pos_;
+  }
+
+  // Whether the keyword (any case) starts at i and ends at a word boundary
+  bool keyword_at(size_t i, std::string_view word) const {
+    if (s_.size() - i < word.size())
+      return false;
+    for (size_t k = 0; k < word.size(); ++k)
+      if (fold(s_[i + k]) != word[k])
+        return false;
+    size_t end = i + word.size();
+    return end == s_.size() || is_space(s_[end]) || s_[end] == '(';
+  }
+
+  bool accept(std::string_view word) {
+    skip_space();
+    if (!keyword_at(pos_, word))
+      return false;
+    pos_ += word.size();
+    return true;
+  }
+
+  static FilterExpr combine(FilterExpr::Kind kind,
+                            std::vector<FilterExpr> operands) {
+    if (operands.size() == 1)
+      return std::move(operands[0]);
+    FilterExpr e;
+    e.kind = kind;
+    e.operands = std::move(operands);
+    return e;
+  }
+
+  FilterExpr parse_or() {
+    std::vector<FilterExpr> operands;
+    operands.push_back(parse_and());
+    while (accept("or"))
+      operands.push_back(parse_and());
+    return combine(FilterExpr::Kind::Or, std::move(operands));
+  }
+
+  FilterExpr parse_and() {
+    std::vector<FilterExpr> operands;
+    operands.push_back(parse_not());
+    while (accept("and"))
+      operands.push_back(parse_not());
+    return combine(FilterExpr::Kind::And, std::move(operands));
+  }
+
+  FilterExpr parse_not() {
+    if (accept("not")) {
+      structured_ = true;
+      FilterExpr e;
+      e.kind = FilterExpr::Kind::Not;
+      e.operands.push_back(parse_not());
+      return e;
+    }
+    skip_space();
+    if (pos_ < s_.size() && s_[pos_] == '(') {
+      ++pos_;
+      ++depth_;
+      structured_ = true;
+      FilterExpr e = parse_or();
+      skip_space();
+      if (pos_ == s_.size() || s_[pos_] != ')')
+        throw std::runtime_error("Invalid filter: missing ')'");
+      ++pos_;
+      --depth_;
+      return e;
+    }
+    return parse_comparison();
+  }
+
+  // Comparison text runs to the next and/or, or to a ')' closing an open
+  // group; parentheses balanced within it, and anything in double
+  // quotes, are part of the value
+  FilterExpr parse_comparison() {
+    size_t start = pos_;
+    size_t nested = 0;
+    bool quoted = false;
+    for (; pos_ < s_.size(); ++pos_) {
+      char c = s_[pos_];
+      if (c == '"') {
+        quoted = !quoted;
+      } else if (quoted) {
+        continue;
+      } else if (c == '(') {
+        ++nested;
+      } else if (c == ')') {
+        if (nested == 0 && depth_ > 0)
+          break;
+        nested -= nested > 0;
+      } else if (is_space(c) && nested == 0 &&
+                 (keyword_at(pos_ + 1, "and") || keyword_at(pos_ + 1, "or"))) {
+        break;
+      }
+    }
+    auto text = trim(s_.substr(start, pos_ - start));
+    if (text.empty())
+      throw std::runtime_error(
+          pos_ < s_.size() ? "Invalid filter: expected a comparison before '" +
+                                 std::string(s_.substr(pos_)) + "'"
+                           : "Invalid filter: expected a comparison at the "
+                             "end");
+    FilterExpr e;
+    try {
+      e.filter = parse_filter(text);
+      mixed_ |= parts_ > 0;
+    } catch (const std::runtime_error &err) {
+      if (error_.empty())
+        error_ = err.what();
+    }
+    ++parts_;
+    return e;
+  }
+};
+} // namespace
+
+FilterExpr parse_filter_expr(std::string_view expr) {
+  if (trim(expr).empty())
+    throw std::runtime_error("Empty filter expression");
+  try {
+    return ExprParser(expr).parse();
+  } catch (const ComparisonError &err) {
+    // "dept == R and D or salary > 94000" could be read either way
+    if (err.mixed)
+      throw std::runtime_error(
+          std::string(err.what()) +
+          "\nQuote a value containing and/or: dept == \"R and D\"");
+    // A value containing and/or: the whole string is one comparison
+    FilterExpr e;
+    e.filter = parse_filter(expr);
+    return e;
+  }
+}
+
+static void collect_filters(const FilterExpr &expr,
+                            std::vector<const Filter *> &out) {
+  if (expr.kind == FilterExpr::Kind::Compare)
+    out.push_back(&expr.filter);
+  for (auto &operand : expr.operands)
+    collect_filters(operand, out);
+}
+
+std::vector<const Filter *> expr_filters(const FilterExpr &expr) {
+  std::vector<const Filter *> out;
+  collect_filters(expr, out);
+  return out;
 }
 
 static bool is_numeric_type(ColumnType t) {
@@ -115,155 +357,780 @@ static bool is_numeric_type(ColumnType t) {
          t == ColumnType::Currency;
 }
 
-static bool compare_strings(const std::string &cell, FilterOp op,
-                            const std::string &value, bool ci) {
-  std::string a = ci ? to_lower(cell) : cell;
-  std::string b = ci ? to_lower(value) : value;
+static bool is_text_op(FilterOp op) {
+  return op == FilterOp::Contains || op == FilterOp::StartsWith ||
+         op == FilterOp::EndsWith;
+}
 
-  switch (op) {
-  case FilterOp::Eq:
+// --- Compiled filters ---
+//
+// Each filter is compiled once against its column: literals are parsed
+// for the column's type (and case-folded under -i), and the matcher for
+// its operator and type is picked as a template instance, so a row costs
+// one indirect call and a direct compare.
+
+// Three-way bytewise comparison, as std::string orders. Under CI the cell
+// is folded as it is read; the literal was folded when compiled.
+template <bool CI> static int compare_text(std::string_view a,
+                                           std::string_view b) {
+  if constexpr (!CI) {
+    return a.compare(b);
+  } else {
+    size_t n = std::min(a.size(), b.size());
+    for (size_t i = 0; i < n; ++i) {
+      auto ca = static_cast<unsigned char>(fold(a[i]));
+      auto cb = static_cast<unsigned char>(b[i]);
+      if (ca != cb)
+        return ca < cb ? -1 : 1;
+    }
+    return a.size() < b.size() ? -1 : a.size() > b.size();
+  }
+}
+
+template <FilterOp Op, typename T> static bool holds(const T &a, const T &b) {
+  if constexpr (Op == FilterOp::Eq || Op == FilterOp::In)
     return a == b;
-  case FilterOp::Neq:
+  else if constexpr (Op == FilterOp::Neq)
     return a != b;
-  case FilterOp::Gt:
+  else if constexpr (Op == FilterOp::Gt)
     return a > b;
-  case FilterOp::Lt:
+  else if constexpr (Op == FilterOp::Lt)
     return a < b;
-  case FilterOp::Gte:
+  else if constexpr (Op == FilterOp::Gte)
     return a >= b;
-  case FilterOp::Lte:
+  else
     return a <= b;
-  case FilterOp::Contains:
-    return a.find(b) != std::string::npos;
-  case FilterOp::StartsWith:
-    return a.size() >= b.size() && a.compare(0, b.size(), b) == 0;
-  case FilterOp::EndsWith:
-    return a.size() >= b.size() &&
-           a.compare(a.size() - b.size(), b.size(), b) == 0;
+}
+
+template <FilterOp Op, bool CI>
+static bool text_holds(std::string_view cell, const TextMatcher &lit) {
+  if constexpr (Op == FilterOp::Contains)
+    return lit.contains(cell);
+  else if constexpr (Op == FilterOp::StartsWith)
+    return lit.starts_with(cell);
+  else if constexpr (Op == FilterOp::EndsWith)
+    return lit.ends_with(cell);
+  else if constexpr (Op == FilterOp::Eq || Op == FilterOp::In ||
+                     Op == FilterOp::Neq)
+    return lit.equals(cell) == (Op != FilterOp::Neq);
+  else
+    return holds<Op>(compare_text<CI>(cell, lit.needle()), 0);
+}
+
+// How the cells of a column compare when both they and the literal parse
+// as its type: numbers by value, dates by day, bools by truth value. Every
+// other cell, and every text operator, compares as text.
+enum class CellKind { Text, Number, Date, Bool };
+
+static CellKind cell_kind(ColumnType type, FilterOp op) {
+  if (is_text_op(op))
+    return CellKind::Text;
+  switch (type) {
+  case ColumnType::Int64:
+  case ColumnType::Float64:
+  case ColumnType::Currency:
+    return CellKind::Number;
+  case ColumnType::Date:
+    return CellKind::Date;
+  case ColumnType::Bool:
+    return op == FilterOp::Eq || op == FilterOp::Neq || op == FilterOp::In
+               ? CellKind::Bool
+               : CellKind::Text;
+  default:
+    return CellKind::Text;
+  }
+}
+
+// A cell as kind K, as the number it compares by
+template <CellKind K> static bool parse_cell(std::string_view s, double &v) {
+  if constexpr (K == CellKind::Number) {
+    return parse_number(s, v);
+  } else if constexpr (K == CellKind::Date) {
+    int64_t days;
+    if (!parse_date_days(s, days))
+      return false;
+    v = static_cast<double>(days);
+    return true;
+  } else if constexpr (K == CellKind::Bool) {
+    bool b;
+    if (!parse_bool(s, b))
+      return false;
+    v = b;
+    return true;
+  } else {
+    return false;
+  }
+}
+
+// Calls fn with kind as a compile-time constant
+template <typename Fn> static auto with_kind(CellKind kind, Fn &&fn) {
+  switch (kind) {
+  case CellKind::Number:
+    return fn(std::integral_constant<CellKind, CellKind::Number>{});
+  case CellKind::Date:
+    return fn(std::integral_constant<CellKind, CellKind::Date>{});
+  case CellKind::Bool:
+    return fn(std::integral_constant<CellKind, CellKind::Bool>{});
+  case CellKind::Text:
+    break;
+  }
+  return fn(std::integral_constant<CellKind, CellKind::Text>{});
+}
+
+namespace {
+// A filter value as compiled: its text, prepared for searches (and
+// folded under -i), and, when it parses as the column's kind, the value a
+// cell of that kind compares against
+struct Literal {
+  TextMatcher text;
+  bool typed = false;
+  double value = 0.0;
+};
+
+struct CompiledFilter;
+using RowMatcher = bool (*)(const CompiledFilter &, const RowView &, size_t);
+using CellMatcher = bool (*)(const CompiledFilter &, std::string_view);
+// Evaluates the 64-row bitmap words [first, first + count) into out; only
+// the bits set in todo have to be right
+using BlockMatcher = void (*)(const CompiledFilter &, const CsvReader &,
+                              size_t first, size_t count,
+                              const uint64_t *todo, uint64_t *out);
+
+struct CompiledFilter {
+  size_t col_idx;
+  FilterOp op;
+  std::vector<Literal> literals; // In: one per value
+  // The text comparison, also used for cells that failed to decode
+  RowMatcher match_text = nullptr;
+  CellMatcher match_cell = nullptr;
+  BlockMatcher match_block = nullptr;
+  // The decoded column, when the comparison can be made on typed values
+  const TypedColumn *typed = nullptr;
+  // Numeric and date columns: the values in [lo, hi] match, or those
+  // outside it when negate is set
+  double lo = 0.0, hi = 0.0;
+  int64_t lo_int = 0, hi_int = 0;
+  bool negate = false;
+  bool flag = false;           // Bool: the value Eq compares against
+  std::vector<uint64_t> codes; // Enum: bit per dictionary code that matches
+};
+} // namespace
+
+// A cell matches when it holds for any literal (In) or the only one. It
+// compares as its kind when both sides parse as it, as decoded columns do,
+// so a stream and a mapped file give the same answer.
+template <FilterOp Op, bool CI, CellKind K>
+static bool cell_matches(const CompiledFilter &f, std::string_view cell) {
+  double v;
+  bool cell_typed = parse_cell<K>(cell, v);
+  for (auto &lit : f.literals) {
+    if (cell_typed && lit.typed ? holds<Op>(v, lit.value)
+                                : text_holds<Op, CI>(cell, lit.text))
+      return true;
   }
   return false;
 }
 
-static bool compare_numeric(double cell_val, FilterOp op, double filter_val) {
+template <FilterOp Op, bool CI, CellKind K>
+static bool row_matches(const CompiledFilter &f, const RowView &row,
+                        size_t) {
+  if (f.col_idx >= row.size())
+    return false;
+  // Only a quoted field with escaped quotes needs a copy to unquote
+  auto field = row[f.col_idx];
+  auto cell = strip_quotes(field);
+  if (cell.size() != field.size() &&
+      cell.find('"') != std::string_view::npos)
+    return cell_matches<Op, CI, K>(f, unquote(field));
+  return cell_matches<Op, CI, K>(f, cell);
+}
+
+// --- Block evaluation ---
+//
+// Filters are evaluated over blocks of kBlockRows rows into bitmaps that
+// are combined a word at a time. Blocks start at multiples of 64 rows, so
+// their words line up with the validity and bool bitmaps of decoded
+// columns.
+
+static constexpr size_t kBlockRows = 1024;
+static constexpr size_t kBlockWords = kBlockRows / 64;
+
+// Bit i set when lo <= v[i] <= hi, for n <= 64 values
+static uint64_t range_bits(const double *v, size_t n, double lo, double hi) {
+  uint64_t bits = 0;
+  size_t i = 0;
+#ifdef __ARM_NEON
+  float64x2_t vlo = vdupq_n_f64(lo), vhi = vdupq_n_f64(hi);
+  for (; i + 2 <= n; i += 2) {
+    float64x2_t x = vld1q_f64(v + i);
+    uint64x2_t m = vandq_u64(vcgeq_f64(x, vlo), vcleq_f64(x, vhi));
+    bits |= ((vgetq_lane_u64(m, 0) & 1) | (vgetq_lane_u64(m, 1) & 2)) << i;
+  }
+#elif defined(__AVX2__)
+  __m256d vlo = _mm256_set1_pd(lo), vhi = _mm256_set1_pd(hi);
+  for (; i + 4 <= n; i += 4) {
+    __m256d x = _mm256_loadu_pd(v + i);
+    __m256d m = _mm256_and_pd(_mm256_cmp_pd(x, vlo, _CMP_GE_OQ),
+                              _mm256_cmp_pd(x, vhi, _CMP_LE_OQ));
+    bits |= static_cast<uint64_t>(_mm256_movemask_pd(m)) << i;
+  }
+#elif defined(__SSE2__)
+  __m128d vlo = _mm_set1_pd(lo), vhi = _mm_set1_pd(hi);
+  for (; i + 2 <= n; i += 2) {
+    __m128d x = _mm_loadu_pd(v + i);
+    __m128d m = _mm_and_pd(_mm_cmpge_pd(x, vlo), _mm_cmple_pd(x, vhi));
+    bits |= static_cast<uint64_t>(_mm_movemask_pd(m)) << i;
+  }
+#endif
+  for (; i < n; ++i)
+    bits |= static_cast<uint64_t>(v[i] >= lo && v[i] <= hi) << i;
+  return bits;
+}
+
+static uint64_t range_bits(const int64_t *v, size_t n, int64_t lo,
+                           int64_t hi) {
+  uint64_t bits = 0;
+  size_t i = 0;
+#ifdef __ARM_NEON
+  int64x2_t vlo = vdupq_n_s64(lo), vhi = vdupq_n_s64(hi);
+  for (; i + 2 <= n; i += 2) {
+    int64x2_t x = vld1q_s64(v + i);
+    uint64x2_t m = vandq_u64(vcgeq_s64(x, vlo), vcleq_s64(x, vhi));
+    bits |= ((vgetq_lane_u64(m, 0) & 1) | (vgetq_lane_u64(m, 1) & 2)) << i;
+  }
+#elif defined(__AVX2__)
+  __m256i vlo = _mm256_set1_epi64x(lo), vhi = _mm256_set1_epi64x(hi);
+  for (; i + 4 <= n; i += 4) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(v + i));
+    __m256i out = _mm256_or_si256(_mm256_cmpgt_epi64(vlo, x),
+                                  _mm256_cmpgt_epi64(x, vhi));
+    auto m = ~_mm256_movemask_pd(_mm256_castsi256_pd(out)) & 0xF;
+    bits |= static_cast<uint64_t>(m) << i;
+  }
+#endif
+  for (; i < n; ++i)
+    bits |= static_cast<uint64_t>(v[i] >= lo && v[i] <= hi) << i;
+  return bits;
+}
+
+// The rows of one word, from its first row, that match as text
+static uint64_t text_bits(const CompiledFilter &f, const CsvReader &reader,
+                          size_t base, uint64_t rows) {
+  uint64_t bits = 0;
+  for (; rows; rows &= rows - 1) {
+    size_t b = std::countr_zero(rows);
+    if (f.match_text(f, reader.row(base + b), base + b))
+      bits |= uint64_t{1} << b;
+  }
+  return bits;
+}
+
+static void text_block(const CompiledFilter &f, const CsvReader &reader,
+                       size_t first, size_t count, const uint64_t *todo,
+                       uint64_t *out) {
+  for (size_t w = 0; w < count; ++w)
+    out[w] = text_bits(f, reader, (first + w) * 64, todo[w]);
+}
+
+template <typename T>
+static void range_block(const CompiledFilter &f, const CsvReader &reader,
+                        size_t first, size_t count, const uint64_t *todo,
+                        uint64_t *out) {
+  const TypedColumn &c = *f.typed;
+  size_t rows = reader.row_count();
+  for (size_t w = 0; w < count; ++w) {
+    size_t base = (first + w) * 64;
+    size_t n = std::min<size_t>(64, rows - base);
+    uint64_t in;
+    if constexpr (std::is_same_v<T, double>)
+      in = range_bits(c.floats.data() + base, n, f.lo, f.hi);
+    else
+      in = range_bits(c.ints.data() + base, n, f.lo_int, f.hi_int);
+    if (f.negate)
+      in = ~in;
+    uint64_t valid = c.valid[first + w];
+    out[w] = (in & valid) | text_bits(f, reader, base, todo[w] & ~valid);
+  }
+}
+
+static void bool_block(const CompiledFilter &f, const CsvReader &reader,
+                       size_t first, size_t count, const uint64_t *todo,
+                       uint64_t *out) {
+  const TypedColumn &c = *f.typed;
+  for (size_t w = 0; w < count; ++w) {
+    uint64_t in = f.flag ? c.bools[first + w] : ~c.bools[first + w];
+    if (f.op == FilterOp::Neq)
+      in = ~in;
+    uint64_t valid = c.valid[first + w];
+    out[w] = (in & valid) |
+             text_bits(f, reader, (first + w) * 64, todo[w] & ~valid);
+  }
+}
+
+static void enum_block(const CompiledFilter &f, const CsvReader &,
+                       size_t first, size_t count, const uint64_t *todo,
+                       uint64_t *out) {
+  const uint32_t *codes = f.typed->codes.data();
+  for (size_t w = 0; w < count; ++w) {
+    size_t base = (first + w) * 64;
+    uint64_t bits = 0;
+    for (uint64_t rows = todo[w]; rows; rows &= rows - 1) {
+      size_t b = std::countr_zero(rows);
+      uint32_t code = codes[base + b];
+      bits |= ((f.codes[code >> 6] >> (code & 63)) & 1) << b;
+    }
+    out[w] = bits;
+  }
+}
+
+// Calls fn with op as a compile-time constant
+template <typename Fn> static auto with_op(FilterOp op, Fn &&fn) {
   switch (op) {
-  case FilterOp::Eq:
-    return cell_val == filter_val;
   case FilterOp::Neq:
-    return cell_val != filter_val;
+    return fn(std::integral_constant<FilterOp, FilterOp::Neq>{});
   case FilterOp::Gt:
-    return cell_val > filter_val;
+    return fn(std::integral_constant<FilterOp, FilterOp::Gt>{});
   case FilterOp::Lt:
-    return cell_val < filter_val;
+    return fn(std::integral_constant<FilterOp, FilterOp::Lt>{});
   case FilterOp::Gte:
-    return cell_val >= filter_val;
+    return fn(std::integral_constant<FilterOp, FilterOp::Gte>{});
   case FilterOp::Lte:
-    return cell_val <= filter_val;
+    return fn(std::integral_constant<FilterOp, FilterOp::Lte>{});
   case FilterOp::Contains:
+    return fn(std::integral_constant<FilterOp, FilterOp::Contains>{});
   case FilterOp::StartsWith:
+    return fn(std::integral_constant<FilterOp, FilterOp::StartsWith>{});
   case FilterOp::EndsWith:
-    return false;
+    return fn(std::integral_constant<FilterOp, FilterOp::EndsWith>{});
+  case FilterOp::Eq:
+  case FilterOp::In:
+    break;
   }
-  return false;
+  return fn(std::integral_constant<FilterOp, FilterOp::Eq>{});
+}
+
+// Compiles a filter on column col_idx of type col_type. An In filter
+// compiles as Eq over several literals.
+static CompiledFilter compile_filter(const Filter &filter, size_t col_idx,
+                                     ColumnType col_type, bool ci) {
+  CompiledFilter f;
+  f.col_idx = col_idx;
+  f.op = filter.op;
+  CellKind kind = cell_kind(col_type, filter.op);
+  auto add_literal = [&](const std::string &value) {
+    Literal lit;
+    lit.text = TextMatcher(value, ci);
+    lit.typed = with_kind(kind, [&](auto k) {
+      return parse_cell<decltype(k)::value>(value, lit.value);
+    });
+    f.literals.push_back(std::move(lit));
+  };
+  if (filter.op == FilterOp::In)
+    for (auto &v : in_values(filter))
+      add_literal(v);
+  else
+    add_literal(filter.value);
+
+  with_op(filter.op, [&](auto op) {
+    return with_kind(kind, [&](auto k) {
+      constexpr FilterOp Op = decltype(op)::value;
+      constexpr CellKind K = decltype(k)::value;
+      f.match_text = ci ? row_matches<Op, true, K> : row_matches<Op, false, K>;
+      f.match_cell =
+          ci ? cell_matches<Op, true, K> : cell_matches<Op, false, K>;
+      return 0;
+    });
+  });
+  f.match_block = text_block;
+  return f;
 }
 
-static bool row_matches(std::span<const std::string_view> row,
-                        const Filter &filter, size_t col_idx,
-                        ColumnType col_type, bool ci) {
-  if (col_idx >= row.size())
+// The least x with f(x) >= bound, or f(x) > bound when strict, for a
+// nondecreasing f; false when there is none
+template <typename F>
+static bool least_reaching(F f, double bound, bool strict, int64_t &x) {
+  auto reaches = [&](int64_t v) {
+    return strict ? f(v) > bound : f(v) >= bound;
+  };
+  int64_t lo = INT64_MIN, hi = INT64_MAX;
+  if (!reaches(hi))
     return false;
+  while (lo < hi) {
+    int64_t mid = lo + static_cast<int64_t>((static_cast<uint64_t>(hi) -
+                                             static_cast<uint64_t>(lo)) /
+                                            2);
+    if (reaches(mid))
+      hi = mid;
+    else
+      lo = mid + 1;
+  }
+  x = lo;
+  return true;
+}
 
-  std::string cell_str = unquote(row[col_idx]);
+// The range of stored integers whose value as compared, f(x), satisfies
+// the filter against number. Searching through f keeps every rounding of
+// the conversion the row-at-a-time comparison made.
+template <typename F>
+static void integer_range(CompiledFilter &cf, F f, double number) {
+  int64_t at, above; // the least values reaching number and passing it
+  bool has_at = least_reaching(f, number, false, at);
+  bool has_above = least_reaching(f, number, true, above);
+  int64_t lo = INT64_MIN, hi = INT64_MAX;
+  bool empty = false;
+  switch (cf.op) {
+  case FilterOp::Gte:
+    empty = !has_at;
+    lo = at;
+    break;
+  case FilterOp::Gt:
+    empty = !has_above;
+    lo = above;
+    break;
+  case FilterOp::Lt:
+    empty = has_at && at == INT64_MIN;
+    if (has_at && !empty)
+      hi = at - 1;
+    break;
+  case FilterOp::Lte:
+    empty = has_above && above == INT64_MIN;
+    if (has_above && !empty)
+      hi = above - 1;
+    break;
+  default: // Eq, Neq
+    empty = !has_at || (has_above && above == INT64_MIN);
+    lo = at;
+    if (has_above && !empty)
+      hi = above - 1;
+    cf.negate = cf.op == FilterOp::Neq;
+    break;
+  }
+  cf.lo_int = empty ? INT64_MAX : lo;
+  cf.hi_int = empty ? INT64_MIN : hi;
+}
 
-  if (is_numeric_type(col_type) && filter.op != FilterOp::Contains &&
-      filter.op != FilterOp::StartsWith &&
-      filter.op != FilterOp::EndsWith) {
-    try {
-      double cell_val = parse_numeric(cell_str);
-      double filter_val = parse_numeric(filter.value);
-      return compare_numeric(cell_val, filter.op, filter_val);
-    } catch (...) {
-    }
+static void float_range(CompiledFilter &cf, double number) {
+  constexpr double inf = std::numeric_limits<double>::infinity();
+  cf.lo = -inf;
+  cf.hi = inf;
+  switch (cf.op) {
+  case FilterOp::Gt:
+    cf.lo = std::nextafter(number, inf);
+    break;
+  case FilterOp::Gte:
+    cf.lo = number;
+    break;
+  case FilterOp::Lt:
+    cf.hi = std::nextafter(number, -inf);
+    break;
+  case FilterOp::Lte:
+    cf.hi = number;
+    break;
+  default: // Eq, Neq
+    cf.lo = cf.hi = number;
+    cf.negate = cf.op == FilterOp::Neq;
+    break;
   }
+}
 
-  return compare_strings(cell_str, filter.op, filter.value, ci);
+// Switches a compiled filter on a decoded column to its typed values.
+// Numeric columns compare as before, dates by day and bools by truth
+// value, a word of rows at a time. An enum filter is evaluated once per
+// dictionary value, so every operator becomes a lookup of the row's code.
+static void compile_typed(CompiledFilter &f, const TypedColumn *typed) {
+  if (!typed)
+    return;
+  if (typed->type == ColumnType::Enum) {
+    const auto &dict = typed->dictionary;
+    f.codes.assign((dict.size() + 63) / 64, 0);
+    for (size_t code = 0; code < dict.size(); ++code)
+      if (f.match_cell(f, dict[code]))
+        f.codes[code >> 6] |= uint64_t{1} << (code & 63);
+    f.typed = typed;
+    f.match_block = enum_block;
+    return;
+  }
+  if (f.op == FilterOp::In || is_text_op(f.op))
+    return;
+  const Literal &lit = f.literals[0];
+  switch (typed->type) {
+  case ColumnType::Int64:
+    if (!lit.typed)
+      return;
+    integer_range(f, [](int64_t x) { return static_cast<double>(x); },
+                  lit.value);
+    f.match_block = range_block<int64_t>;
+    break;
+  case ColumnType::Currency:
+    if (!lit.typed)
+      return;
+    integer_range(
+        f, [](int64_t x) { return static_cast<double>(x) / 100.0; },
+        lit.value);
+    f.match_block = range_block<int64_t>;
+    break;
+  case ColumnType::Float64:
+    if (!lit.typed)
+      return;
+    float_range(f, lit.value);
+    f.match_block = range_block<double>;
+    break;
+  case ColumnType::Date:
+    if (!lit.typed)
+      return;
+    integer_range(f, [](int64_t x) { return static_cast<double>(x); },
+                  lit.value);
+    f.match_block = range_block<int64_t>;
+    break;
+  case ColumnType::Bool:
+    if ((f.op != FilterOp::Eq && f.op != FilterOp::Neq) || !lit.typed)
+      return;
+    f.flag = lit.value != 0;
+    f.match_block = bool_block;
+    break;
+  default:
+    return;
+  }
+  f.typed = typed;
 }
 
-std::vector<size_t>
-apply_filters(const std::vector<Filter> &filters, const CsvReader &reader,
-              const std::vector<ColumnSchema> &schema, bool case_insensitive,
-              bool or_logic) {
-  struct ResolvedFilter {
-    const Filter *filter;
-    size_t col_idx;
-    ColumnType col_type;
-  };
-  std::vector<ResolvedFilter> resolved;
-  resolved.reserve(filters.size());
+namespace {
+// An expression compiled against a reader. True and False come from
+// constant folding.
+struct PlanNode {
+  enum class Kind { Compare, And, Or, Not, True, False };
+  Kind kind = Kind::Compare;
+  CompiledFilter filter;          // Compare
+  std::vector<PlanNode> operands; // And, Or, Not
+  bool typed = false;             // every comparison decided by words
+};
+} // namespace
 
-  auto &headers = reader.headers();
-  for (auto &f : filters) {
-    bool found = false;
-    std::string f_col = case_insensitive ? to_lower(f.column) : f.column;
-    for (size_t i = 0; i < headers.size(); ++i) {
-      std::string hdr_name = unquote(headers[i]);
-      if (case_insensitive)
-        hdr_name = to_lower(hdr_name);
-      if (hdr_name == f_col) {
-        ColumnType ct =
-            (i < schema.size()) ? schema[i].type : ColumnType::Text;
-        resolved.push_back({&f, i, ct});
-        found = true;
-        break;
-      }
+// Whether an enum comparison matches no code, or every code, in which
+// case it matches no row or every row
+static PlanNode::Kind enum_constant(const CompiledFilter &f) {
+  if (!f.typed || f.typed->type != ColumnType::Enum)
+    return PlanNode::Kind::Compare;
+  size_t n = f.typed->dictionary.size();
+  size_t set = 0;
+  for (uint64_t w : f.codes)
+    set += std::popcount(w);
+  if (set == 0)
+    return PlanNode::Kind::False;
+  return set == n ? PlanNode::Kind::True : PlanNode::Kind::Compare;
+}
+
+namespace {
+struct PlanContext {
+  const CsvReader &reader;
+  const std::vector<ColumnSchema> &schema;
+  bool ci;
+  const ColumnStore *columns;
+};
+} // namespace
+
+static CompiledFilter compile_comparison(const Filter &f,
+                                         const PlanContext &ctx) {
+  auto &headers = ctx.reader.headers();
+  std::string f_col = ctx.ci ? to_lower(f.column) : f.column;
+  for (size_t i = 0; i < headers.size(); ++i) {
+    std::string hdr_name = unquote(headers[i]);
+    if (ctx.ci)
+      hdr_name = to_lower(hdr_name);
+    if (hdr_name == f_col) {
+      ColumnType ct =
+          (i < ctx.schema.size()) ? ctx.schema[i].type : ColumnType::Text;
+      CompiledFilter cf = compile_filter(f, i, ct, ctx.ci);
+      if (ctx.columns)
+        compile_typed(cf, ctx.columns->column(i));
+      return cf;
     }
-    if (!found) {
-      throw std::runtime_error("Column '" + f.column +
-                               "' not found. Available columns: " +
-                               [&]() {
-                                 std::string cols;
-                                 for (size_t i = 0; i < headers.size(); ++i) {
-                                   if (i > 0)
-                                     cols += ", ";
-                                   cols += unquote(headers[i]);
-                                 }
-                                 return cols;
-                               }());
+  }
+  throw std::runtime_error("Column '" + f.column +
+                           "' not found. Available columns: " + [&]() {
+                             std::string cols;
+                             for (size_t i = 0; i < headers.size(); ++i) {
+                               if (i > 0)
+                                 cols += ", ";
+                               cols += unquote(headers[i]);
+                             }
+                             return cols;
+                           }());
+}
+
+// Compiles an expression, folding constants: not of not, and/or nested in
+// their own kind, and operands that decide the whole and/or
+static PlanNode compile_expr(const FilterExpr &expr, const PlanContext &ctx) {
+  using Kind = PlanNode::Kind;
+  PlanNode node;
+  switch (expr.kind) {
+  case FilterExpr::Kind::Compare:
+    node.filter = compile_comparison(expr.filter, ctx);
+    node.kind = enum_constant(node.filter);
+    node.typed = node.filter.typed;
+    return node;
+  case FilterExpr::Kind::Not: {
+    PlanNode inner = compile_expr(expr.operands.at(0), ctx);
+    if (inner.kind == Kind::True || inner.kind == Kind::False) {
+      inner.kind = inner.kind == Kind::True ? Kind::False : Kind::True;
+      return inner;
     }
+    if (inner.kind == Kind::Not)
+      return std::move(inner.operands[0]);
+    node.kind = Kind::Not;
+    node.typed = inner.typed;
+    node.operands.push_back(std::move(inner));
+    return node;
+  }
+  case FilterExpr::Kind::And:
+  case FilterExpr::Kind::Or:
+    break;
   }
 
-  std::vector<size_t> result;
-  for (size_t r = 0; r < reader.row_count(); ++r) {
-    auto row = reader.row(r);
-    bool match;
-    if (or_logic) {
-      match = false;
-      for (auto &rf : resolved) {
-        if (row_matches(row, *rf.filter, rf.col_idx, rf.col_type,
-                        case_insensitive)) {
-          match = true;
-          break;
-        }
-      }
+  bool is_and = expr.kind == FilterExpr::Kind::And;
+  node.kind = is_and ? Kind::And : Kind::Or;
+  // An operand equal to the identity drops out; one equal to the
+  // absorbing value decides the node
+  Kind identity = is_and ? Kind::True : Kind::False;
+  Kind absorbing = is_and ? Kind::False : Kind::True;
+  bool decided = false;
+  for (auto &operand : expr.operands) {
+    // Compiled even once decided, so unknown columns are still reported
+    PlanNode p = compile_expr(operand, ctx);
+    if (p.kind == identity)
+      continue;
+    decided |= p.kind == absorbing;
+    if (p.kind == node.kind) {
+      for (auto &inner : p.operands)
+        node.operands.push_back(std::move(inner));
     } else {
-      match = true;
-      for (auto &rf : resolved) {
-        if (!row_matches(row, *rf.filter, rf.col_idx, rf.col_type,
-                         case_insensitive)) {
-          match = false;
-          break;
-        }
-      }
+      node.operands.push_back(std::move(p));
     }
-    if (match)
-      result.push_back(r);
   }
+  if (decided) {
+    node.kind = absorbing;
+    node.operands.clear();
+    return node;
+  }
+  if (node.operands.empty()) {
+    node.kind = identity;
+    return node;
+  }
+  if (node.operands.size() == 1)
+    return std::move(node.operands[0]);
+
+  // Typed operands decide a word at a time; run them first so the text
+  // comparisons only see the rows still undecided
+  std::stable_partition(node.operands.begin(), node.operands.end(),
+                        [](const PlanNode &p) { return p.typed; });
+  node.typed = node.operands.back().typed;
+  return node;
+}
+
+// Evaluates a node over the words [first, first + words) of one block
+// into out. Only the bits set in todo have to be right, and operands of
+// and/or only see the rows their siblings left undecided.
+static void eval_node(const PlanNode &node, const CsvReader &reader,
+                      size_t first, size_t words, const uint64_t *todo,
+                      uint64_t *out) {
+  using Kind = PlanNode::Kind;
+  uint64_t pending[kBlockWords], bits[kBlockWords];
+  switch (node.kind) {
+  case Kind::True:
+  case Kind::False:
+    std::fill(out, out + words, node.kind == Kind::True ? ~uint64_t{0} : 0);
+    return;
+  case Kind::Compare:
+    node.filter.match_block(node.filter, reader, first, words, todo, out);
+    return;
+  case Kind::Not:
+    eval_node(node.operands[0], reader, first, words, todo, out);
+    for (size_t w = 0; w < words; ++w)
+      out[w] = ~out[w];
+    return;
+  case Kind::And:
+  case Kind::Or:
+    break;
+  }
+
+  bool is_and = node.kind == Kind::And;
+  std::fill(out, out + words, is_and ? ~uint64_t{0} : 0);
+  for (auto &operand : node.operands) {
+    uint64_t any = 0;
+    for (size_t w = 0; w < words; ++w)
+      any |= pending[w] = todo[w] & (is_and ? out[w] : ~out[w]);
+    if (!any)
+      return;
+    eval_node(operand, reader, first, words, pending, bits);
+    for (size_t w = 0; w < words; ++w)
+      out[w] = is_and ? out[w] & bits[w] : out[w] | (bits[w] & pending[w]);
+  }
+}
+
+std::vector<size_t> apply_filters(const FilterExpr &expr,
+                                  const CsvReader &reader,
+                                  const std::vector<ColumnSchema> &schema,
+                                  bool case_insensitive,
+                                  const ColumnStore *columns,
+                                  size_t threads) {
+  PlanNode plan =
+      compile_expr(expr, {reader, schema, case_insensitive, columns});
 
+  // Threads take runs of whole blocks and keep their matches apart, so
+  // concatenating them in thread order gives the serial result
+  size_t rows = reader.row_count();
+  size_t blocks = (rows + kBlockRows - 1) / kBlockRows;
+  size_t n = threads_for(blocks, threads, kMinRowsPerThread / kBlockRows);
+  std::vector<std::vector<size_t>> parts(n);
+  run_parallel(n, [&](size_t t) {
+    uint64_t todo[kBlockWords], match[kBlockWords];
+    auto &out = parts[t];
+    size_t end = part_begin(blocks, n, t + 1);
+    for (size_t b = part_begin(blocks, n, t); b < end; ++b) {
+      size_t start = b * kBlockRows;
+      size_t count = std::min(kBlockRows, rows - start);
+      size_t words = (count + 63) / 64;
+      for (size_t w = 0; w < words; ++w) {
+        size_t in_word = std::min<size_t>(64, count - w * 64);
+        todo[w] = in_word == 64 ? ~uint64_t{0} : (uint64_t{1} << in_word) - 1;
+      }
+      eval_node(plan, reader, start / 64, words, todo, match);
+      for (size_t w = 0; w < words; ++w)
+        for (uint64_t m = match[w] & todo[w]; m; m &= m - 1)
+          out.push_back(start + w * 64 + std::countr_zero(m));
+    }
+  });
+
+  if (n == 1)
+    return std::move(parts[0]);
+  size_t total = 0;
+  for (auto &part : parts)
+    total += part.size();
+  std::vector<size_t> result;
+  result.reserve(total);
+  for (auto &part : parts)
+    result.insert(result.end(), part.begin(), part.end());
   return result;
 }
 
+std::vector<size_t>
+apply_filters(const std::vector<Filter> &filters, const CsvReader &reader,
+              const std::vector<ColumnSchema> &schema, bool case_insensitive,
+              bool or_logic, const ColumnStore *columns, size_t threads) {
+  FilterExpr expr;
+  expr.kind = or_logic ? FilterExpr::Kind::Or : FilterExpr::Kind::And;
+  for (auto &f : filters) {
+    expr.operands.emplace_back();
+    expr.operands.back().filter = f;
+  }
+  return apply_filters(expr, reader, schema, case_insensitive, columns,
+                       threads);
+}
+
 void sort_indices(std::vector<size_t> &indices, const CsvReader &reader,
                   const std::vector<ColumnSchema> &schema,
-                  const std::string &col_name, bool descending) {
+                  const std::string &col_name, bool descending,
+                  const ColumnStore *columns) {
   auto &headers = reader.headers();
   size_t col_idx = SIZE_MAX;
   ColumnType col_type = ColumnType::Text;
@@ -290,27 +1157,61 @@ void sort_indices(std::vector<size_t> &indices, const CsvReader &reader,
                              }());
   }
 
+  const TypedColumn *typed = columns ? columns->column(col_idx) : nullptr;
+
+  // Without decoded values a numeric column is parsed once up front; a
+  // pair with a cell that is not a number compares as text
+  std::vector<double> numbers;
+  if (!typed && is_numeric_type(col_type))
+    numbers = parse_number_column(reader, col_idx, &indices);
+
   bool numeric = is_numeric_type(col_type);
+  auto number_at = [&](size_t r, double &d) {
+    if (!numbers.empty()) {
+      d = numbers[r];
+      return !std::isnan(d);
+    }
+    auto row = reader.row(r);
+    return col_idx < row.size() &&
+           parse_number(strip_quotes(row[col_idx]), d);
+  };
+
+  auto text_less = [&](size_t a, size_t b) -> bool {
+    double da, db;
+    if (numeric && number_at(a, da) && number_at(b, db))
+      return descending ? da > db : da < db;
+    auto row_a = reader.row(a);
+    auto row_b = reader.row(b);
+    std::string va = (col_idx < row_a.size()) ? unquote(row_a[col_idx]) : "";
+    std::string vb = (col_idx < row_b.size()) ? unquote(row_b[col_idx]) : "";
+    return descending ? va > vb : va < vb;
+  };
 
-  std::stable_sort(indices.begin(), indices.end(),
-                   [&](size_t a, size_t b) -> bool {
-                     auto row_a = reader.row(a);
-                     auto row_b = reader.row(b);
-                     std::string va =
-                         (col_idx < row_a.size()) ? unquote(row_a[col_idx]) : "";
-                     std::string vb =
-                         (col_idx < row_b.size()) ? unquote(row_b[col_idx]) : "";
-
-                     if (numeric) {
-                       try {
-                         double da = parse_numeric(va);
-                         double db = parse_numeric(vb);
-                         return descending ? da > db : da < db;
-                       } catch (...) {
-                       }
-                     }
-                     return descending ? va > vb : va < vb;
-                   });
+  if (!typed) {
+    std::stable_sort(indices.begin(), indices.end(), text_less);
+    return;
+  }
+
+  // Decoded keys; a pair with an undecodable cell compares as text
+  auto typed_less = [&](size_t a, size_t b) -> bool {
+    if (typed->type == ColumnType::Enum) {
+      uint32_t ca = typed->codes[a], cb = typed->codes[b];
+      return descending ? ca > cb : ca < cb;
+    }
+    if (!typed->is_valid(a) || !typed->is_valid(b))
+      return text_less(a, b);
+    if (typed->type == ColumnType::Bool) {
+      bool fa = typed->flag(a), fb = typed->flag(b);
+      return descending ? fa > fb : fa < fb;
+    }
+    if (typed->type == ColumnType::Float64) {
+      double da = typed->floats[a], db = typed->floats[b];
+      return descending ? da > db : da < db;
+    }
+    int64_t ia = typed->ints[a], ib = typed->ints[b];
+    return descending ? ia > ib : ia < ib;
+  };
+  std::stable_sort(indices.begin(), indices.end(), typed_less);
 }
 
 std::vector<size_t> resolve_columns(const std::string &select_str,
@@ -1,51 +1,202 @@
+#include "include/column_stats.hpp"
+#include "include/columns.hpp"
 #include "include/csv_reader.hpp"
+#include "include/decompress.hpp"
 #include "include/delim.hpp"
 #include "include/filter.hpp"
 #include "include/pager.hpp"
+#include "include/parallel.hpp"
+#include "include/sidecar.hpp"
 #include "include/tui.hpp"
 #include "include/type_inference.hpp"
 #include <algorithm>
+#include <atomic>
 #include <cstdlib>
 #include <cstring>
+#include <fcntl.h>
+#include <glob.h>
 #include <iostream>
+#include <memory>
 #include <numeric>
+#include <random>
+#include <stdexcept>
 #include <string>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <vector>
 
+// Streamed input is read and filtered in blocks of about this size
+static constexpr size_t kStreamBlockBytes = 1 << 20;
+
+static Compression input_compression(const std::string &path) {
+  if (path == "-")
+    return peek_compression(STDIN_FILENO);
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return Compression::None;
+  Compression c = peek_compression(fd);
+  close(fd);
+  return c;
+}
+
+// Records seek points through a compressed file so later runs can start
+// decompressing near the rows they need
+static void write_compressed_index(const std::string &path, Compression c,
+                                   size_t threads) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw std::runtime_error("Failed to open csv file");
+  SeekIndex index;
+  try {
+    index = build_seek_index(fd, c, kSeekSpan, threads);
+  } catch (...) {
+    close(fd);
+    throw;
+  }
+  close(fd);
+  write_seek_index(path, index);
+  if (index.points.size() == 1 && index.total_out > kSeekSpan)
+    std::cerr << "Note: " << path
+              << " has no restart points; recompress it in independent "
+                 "frames (e.g. pzstd or the zstd seekable format) for --tail "
+                 "to skip any of it\n";
+}
+
+// Expands a glob the shell left alone (quoted, or too many matches for one
+// command line). Anything else, including a file whose name happens to
+// contain glob characters, is taken literally.
+static bool expand_input(const char *arg, std::vector<std::string> &out) {
+  struct stat sbuf;
+  if (!std::strpbrk(arg, "*?[") || stat(arg, &sbuf) == 0) {
+    out.push_back(arg);
+    return true;
+  }
+  glob_t matches;
+  int rc = glob(arg, 0, nullptr, &matches);
+  if (rc == 0)
+    for (size_t i = 0; i < matches.gl_pathc; ++i)
+      out.push_back(matches.gl_pathv[i]);
+  globfree(&matches);
+  return rc == 0;
+}
+
+// Shards must repeat the first file's header exactly
+static bool same_columns(const std::vector<std::string> &columns,
+                         const CsvReader &reader) {
+  const auto &headers = reader.headers();
+  return std::equal(columns.begin(), columns.end(), headers.begin(),
+                    headers.end());
+}
+
+// Columns named by filters and the sort key; unknown names are left for
+// apply_filters and sort_indices to report
+static std::vector<size_t>
+referenced_columns(const CsvReader &reader, const FilterExpr &where,
+                   const std::string &sort_col, bool ignore_case) {
+  auto fold = [&](char c) {
+    return ignore_case && c >= 'A' && c <= 'Z' ? static_cast<char>(c + 32) : c;
+  };
+  auto same = [&](std::string_view a, std::string_view b) {
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(),
+                      [&](char x, char y) { return fold(x) == fold(y); });
+  };
+  std::vector<size_t> columns;
+  const auto &headers = reader.headers();
+  for (size_t i = 0; i < headers.size(); ++i) {
+    std::string name = unquote(headers[i]);
+    bool used = !sort_col.empty() && name == sort_col;
+    for (auto *f : expr_filters(where))
+      used |= same(name, f->column);
+    if (used)
+      columns.push_back(i);
+  }
+  return columns;
+}
+
+// The --where expressions as one, joined by --logic
+static FilterExpr parse_where(const std::vector<std::string> &exprs,
+                              bool or_logic) {
+  if (exprs.size() == 1)
+    return parse_filter_expr(exprs[0]);
+  FilterExpr where;
+  where.kind = or_logic ? FilterExpr::Kind::Or : FilterExpr::Kind::And;
+  for (auto &expr : exprs)
+    where.operands.push_back(parse_filter_expr(expr));
+  return where;
+}
+
+// Splits a sample across shards in proportion to their size on disk
+static std::vector<size_t>
+sample_quotas(const std::vector<std::string> &inputs, size_t n) {
+  std::vector<uint64_t> sizes(inputs.size(), 1);
+  uint64_t total = 0;
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    struct stat sbuf;
+    if (stat(inputs[i].c_str(), &sbuf) == 0 && sbuf.st_size > 0)
+      sizes[i] = static_cast<uint64_t>(sbuf.st_size);
+    total += sizes[i];
+  }
+  std::vector<size_t> quotas(inputs.size());
+  size_t given = 0;
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    quotas[i] = static_cast<size_t>(n * sizes[i] / total);
+    given += quotas[i];
+  }
+  for (size_t i = 0; given < n; i = (i + 1) % inputs.size(), ++given)
+    ++quotas[i];
+  return quotas;
+}
+
 static void print_usage() {
   std::cerr
-      << "Usage: glance [file.csv | -] [options]\n"
+      << "Usage: glance [file.csv ... | -] [options]\n"
       << "\n"
       << "Options:\n"
       << "  -n, --head <N>           Show first N rows (default: 50)\n"
       << "  -t, --tail <N>           Show last N rows\n"
+      << "  --sample <N>             Show N rows drawn at random\n"
+      << "  --seed <S>               Seed for --sample (default: random)\n"
       << "  -s, --schema             Output inferred schema as JSON\n"
+      << "  --exact                  With --schema, check every row\n"
+      << "  --stats                  Schema plus per-column statistics\n"
       << "  -w, --where <expr>       Filter rows (repeatable)\n"
       << "  -i, --ignore-case        Case-insensitive filtering\n"
-      << "  --logic <and|or>         Filter logic (default: and)\n"
+      << "  --logic <and|or>         Join repeated --where (default: and)\n"
       << "  --select <col1,col2,...> Show only specified columns\n"
       << "  --sort <col>             Sort by column (ascending)\n"
       << "  --sort-desc <col>        Sort by column (descending)\n"
       << "  --count                  Output only the count of matching rows\n"
       << "  --format <fmt>           Output format: table, csv, tsv, json\n"
       << "  --no-pager               Disable interactive pager\n"
+      << "  --threads <N>            Worker threads (default: all cores)\n"
+      << "  --infer-rows <N>         Rows sampled across the file to infer\n"
+      << "                           column types (default: 1000)\n"
+      << "  --index                  Write <file>.glance-idx for fast re-opens\n"
+      << "  --no-index               Ignore an existing .glance-idx\n"
+      << "  --io <opt,...>           I/O hints: sequential, willneed, populate,\n"
+      << "                           hugepages, dropbehind, pread\n"
       << "  -h, --help               Show this help\n"
       << "\n"
       << "Filter operators: ==, !=, >, <, >=, <=, contains, starts_with, "
-         "ends_with\n"
+         "ends_with, in\n"
+      << "Combine with and, or, not and parentheses within one --where\n"
       << "Example: glance data.csv --where \"age > 30\" --where \"name "
          "contains Al\"\n"
-      << "Stdin:   cat data.csv | glance - --format json\n";
+      << "Stdin:   cat data.csv | glance - --format json\n"
+      << "Shards:  glance 'part-*.csv' --count\n";
 }
 
 enum class OutputFormat { Table, Csv, Tsv, Json };
 
 int main(int argc, char *argv[]) {
-  std::string input_path;
+  std::vector<std::string> inputs;
   int head_count = -1; // -1 = not specified
   int tail_count = -1;
+  int sample_count = -1;
+  uint64_t seed = std::random_device{}();
   bool schema_mode = false;
+  bool exact_schema = false;
+  bool stats_mode = false;
   bool count_mode = false;
   bool no_pager = false;
   bool ignore_case = false;
@@ -55,6 +206,11 @@ int main(int argc, char *argv[]) {
   std::string sort_col;
   bool sort_desc = false;
   std::vector<std::string> where_exprs;
+  size_t threads = default_thread_count();
+  size_t infer_rows = kInferenceBudget;
+  bool write_index = false;
+  bool no_index = false;
+  IoOptions io;
 
   for (int i = 1; i < argc; ++i) {
     if ((std::strcmp(argv[i], "-n") == 0 ||
@@ -65,9 +221,18 @@ int main(int argc, char *argv[]) {
                 std::strcmp(argv[i], "--tail") == 0) &&
                i + 1 < argc) {
       tail_count = std::atoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "--sample") == 0 && i + 1 < argc) {
+      sample_count = std::atoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      seed = std::strtoull(argv[++i], nullptr, 10);
     } else if (std::strcmp(argv[i], "-s") == 0 ||
                std::strcmp(argv[i], "--schema") == 0) {
       schema_mode = true;
+    } else if (std::strcmp(argv[i], "--stats") == 0) {
+      schema_mode = true;
+      stats_mode = true;
+    } else if (std::strcmp(argv[i], "--exact") == 0) {
+      exact_schema = true;
     } else if ((std::strcmp(argv[i], "-w") == 0 ||
                 std::strcmp(argv[i], "--where") == 0) &&
                i + 1 < argc) {
@@ -108,12 +273,36 @@ int main(int argc, char *argv[]) {
       }
     } else if (std::strcmp(argv[i], "--no-pager") == 0) {
       no_pager = true;
+    } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      int n = std::atoi(argv[++i]);
+      threads = (n > 0) ? static_cast<size_t>(n) : 1;
+    } else if (std::strcmp(argv[i], "--infer-rows") == 0 && i + 1 < argc) {
+      int n = std::atoi(argv[++i]);
+      infer_rows = (n > 0) ? static_cast<size_t>(n) : 1;
+    } else if (std::strcmp(argv[i], "--index") == 0) {
+      write_index = true;
+    } else if (std::strcmp(argv[i], "--no-index") == 0) {
+      no_index = true;
+    } else if (std::strcmp(argv[i], "--io") == 0 && i + 1 < argc) {
+      try {
+        io = parse_io_options(argv[++i]);
+      } catch (const std::exception &e) {
+        std::cerr << e.what()
+                  << " (use sequential, willneed, populate, hugepages, "
+                     "dropbehind, pread)\n";
+        return 1;
+      }
     } else if (std::strcmp(argv[i], "-h") == 0 ||
                std::strcmp(argv[i], "--help") == 0) {
       print_usage();
       return 0;
-    } else if (argv[i][0] != '-' || std::strcmp(argv[i], "-") == 0) {
-      input_path = argv[i];
+    } else if (std::strcmp(argv[i], "-") == 0) {
+      inputs.push_back(argv[i]);
+    } else if (argv[i][0] != '-') {
+      if (!expand_input(argv[i], inputs)) {
+        std::cerr << "Error: no files match " << argv[i] << "\n";
+        return 1;
+      }
     } else {
       std::cerr << "Unknown option: " << argv[i] << "\n";
       print_usage();
@@ -122,14 +311,16 @@ int main(int argc, char *argv[]) {
   }
 
   // Handle stdin: if no path and stdin is piped, read from stdin
-  if (input_path.empty()) {
+  if (inputs.empty()) {
     if (!isatty(STDIN_FILENO))
-      input_path = "-";
+      inputs.push_back("-");
     else {
       print_usage();
       return 1;
     }
   }
+  const std::string &input_path = inputs.front();
+  bool sharded = inputs.size() > 1;
 
   // Validate mutually exclusive options
   if (head_count >= 0 && tail_count >= 0) {
@@ -137,27 +328,258 @@ int main(int argc, char *argv[]) {
     return 1;
   }
 
+  if (sample_count >= 0 && (head_count >= 0 || tail_count >= 0)) {
+    std::cerr << "Error: --sample cannot be combined with --head or --tail\n";
+    return 1;
+  }
+
+  if (exact_schema && !schema_mode) {
+    std::cerr << "Error: --exact only applies to --schema\n";
+    return 1;
+  }
+
+  if (write_index && input_path == "-") {
+    std::cerr << "Error: --index needs a file, not stdin\n";
+    return 1;
+  }
+
+  if (sharded && std::count(inputs.begin(), inputs.end(), "-") > 0) {
+    std::cerr << "Error: stdin cannot be combined with other inputs\n";
+    return 1;
+  }
+
+  if (write_index && sharded) {
+    std::cerr << "Error: --index takes a single file\n";
+    return 1;
+  }
+
+  // Determine if we need interactive pager
+  bool stdout_is_tty = isatty(STDOUT_FILENO);
+  bool interactive = stdout_is_tty && !schema_mode && !count_mode &&
+                     format == OutputFormat::Table && !no_pager;
+
+  // Piped and compressed input that is only filtered and written out row
+  // by row is processed one block at a time in constant memory; sort, tail
+  // and the table renderer need every row and buffer the whole stream
+  // instead. Regular files are always read whole, so their schema and
+  // typed filters do not depend on the I/O backend; --io pread only adds
+  // read-ahead to the streams.
+  struct stat stdin_stat;
+  bool stdin_is_file = fstat(STDIN_FILENO, &stdin_stat) == 0 &&
+                       S_ISREG(stdin_stat.st_mode);
+  Compression compression = input_compression(input_path);
+  bool any_compressed = compression != Compression::None;
+  for (size_t i = 1; i < inputs.size() && !any_compressed; ++i)
+    any_compressed = input_compression(inputs[i]) != Compression::None;
+  bool stream_input = (input_path == "-" && !stdin_is_file) || any_compressed;
+  bool streaming = stream_input && !interactive && sort_col.empty() &&
+                   tail_count < 0 && sample_count < 0 && !write_index &&
+                   (count_mode || schema_mode || format != OutputFormat::Table);
+
   try {
-    CsvReader reader(input_path.c_str());
-    char delim = detect_delimiter(reader.data(), reader.size());
+    if (streaming) {
+      // Shards are streamed one after another as a single table
+      auto reader = std::make_unique<CsvReader>(input_path.c_str(),
+                                                kStreamBlockBytes, io);
+      char delim = detect_delimiter(reader->data(), reader->size());
+      reader->parse_lazy(delim, threads);
+      if (reader->column_count() == 0) {
+        std::cerr << "Error: no columns found in file\n";
+        return 1;
+      }
+
+      // Filters use the schema inferred from the first block; --exact
+      // reports one that every block has been checked against
+      auto schema = infer_schema(*reader, infer_rows);
+      SchemaTally tally;
+      StatsTally stats_tally(schema);
+      std::vector<std::string> columns(reader->headers().begin(),
+                                       reader->headers().end());
+
+      std::vector<size_t> col_indices;
+      const std::vector<size_t> *col_ptr = nullptr;
+      if (!select_str.empty()) {
+        col_indices = resolve_columns(select_str, *reader);
+        col_ptr = &col_indices;
+      }
+
+      FilterExpr where = parse_where(where_exprs, or_logic);
+
+      // Row output stops reading as soon as the row limit is reached
+      bool needs_all = count_mode || schema_mode;
+      size_t max_rows =
+          (head_count >= 0) ? static_cast<size_t>(head_count) : 50;
+      char out_delim = (format == OutputFormat::Tsv) ? '\t' : ',';
+
+      size_t match_count = 0;
+      size_t written = 0;
+      std::vector<size_t> filtered;
+      size_t next_input = 1;
+      size_t bytes = 0;
+      for (bool first = true;; first = false) {
+        const std::vector<size_t> *row_ptr = nullptr;
+        size_t matches = reader->row_count();
+        if (!where_exprs.empty()) {
+          filtered = apply_filters(where, *reader, schema, ignore_case,
+                                   nullptr, threads);
+          row_ptr = &filtered;
+          matches = filtered.size();
+        }
+        match_count += matches;
+        if (exact_schema)
+          tally.add(*reader, threads);
+        if (stats_mode)
+          stats_tally.add(*reader, threads, row_ptr);
+
+        if (!needs_all) {
+          // Opened only after the first block was filtered, so a bad
+          // filter fails before any output
+          if (first && format == OutputFormat::Json)
+            render_json_begin();
+          else if (first)
+            render_csv_header(*reader, col_ptr, out_delim);
+
+          size_t room = max_rows - written;
+          if (format == OutputFormat::Json) {
+            render_json_rows(*reader, schema, row_ptr, col_ptr, room,
+                             written);
+          } else {
+            render_csv_rows(*reader, row_ptr, col_ptr, room, out_delim);
+            written += std::min(matches, room);
+          }
+          std::cout.flush();
+          if (written >= max_rows)
+            break;
+        }
+
+        if (reader->read_block()) {
+          reader->parse_lazy(delim, threads);
+          continue;
+        }
+        bytes += reader->bytes_read();
+        if (next_input == inputs.size())
+          break;
+        const std::string &path = inputs[next_input++];
+        reader.reset();
+        reader = std::make_unique<CsvReader>(path.c_str(), kStreamBlockBytes,
+                                             io);
+        reader->parse_lazy(delim, threads);
+        if (!same_columns(columns, *reader)) {
+          std::cerr << "Error: " << path << " has different columns than "
+                    << input_path << "\n";
+          return 1;
+        }
+      }
+
+      if (count_mode)
+        std::cout << match_count << "\n";
+      else if (schema_mode) {
+        auto stats = stats_tally.stats();
+        render_schema_json(exact_schema ? tally.schema() : schema, col_ptr,
+                           match_count, bytes, stats_mode ? &stats : nullptr);
+      }
+      else if (format == OutputFormat::Json)
+        render_json_end(written);
+      return 0;
+    }
 
-    // Determine if we need interactive pager
-    bool stdout_is_tty = isatty(STDOUT_FILENO);
-    bool interactive =
-        stdout_is_tty && !schema_mode && !count_mode &&
-        format == OutputFormat::Table && !no_pager;
+    // Compressed files are indexed by seek points rather than rows; with
+    // one on disk a plain --tail decompresses only the end of the file
+    bool compressed_file =
+        input_path != "-" && compression != Compression::None;
+    if (write_index && compressed_file) {
+      write_compressed_index(input_path, compression, threads);
+      write_index = false;
+    }
+    SeekIndex seek_index;
+    bool tail_seek = compressed_file && !sharded && tail_count >= 0 &&
+                     where_exprs.empty() && sort_col.empty() && !no_index &&
+                     load_seek_index(input_path, seek_index);
+    CsvReader reader =
+        tail_seek ? CsvReader(input_path.c_str(), seek_index,
+                              static_cast<size_t>(tail_count))
+                  : CsvReader(input_path.c_str(), io);
+
+    // A valid sidecar replaces delimiter detection, row scanning and
+    // schema inference
+    SidecarIndex index;
+    bool have_index = input_path != "-" && !sharded && !no_index &&
+                      !write_index && sample_count < 0 &&
+                      load_sidecar(input_path, reader, index);
+    char delim = have_index ? index.delimiter
+                            : detect_delimiter(reader.data(), reader.size());
 
-    // Determine parse mode: full parse needed for filters, sort, tail, or
-    // interactive pager
+    // Determine parse mode: full parse needed for filters, sort, tail,
+    // exact schema, statistics or interactive pager
     bool needs_full = interactive || !where_exprs.empty() ||
-                      !sort_col.empty() || tail_count >= 0;
+                      !sort_col.empty() || tail_count >= 0 || exact_schema ||
+                      stats_mode;
+
+    // Tail without filters or sort only needs the last rows: scan
+    // backwards from the end instead of indexing the whole file
+    bool tail_only =
+        tail_count >= 0 && where_exprs.empty() && sort_col.empty();
+
+    // A sample jumps to random offsets and tokenizes only the rows it lands
+    // on; filters and sort then apply to the sample
+    std::vector<size_t> quotas;
+    if (sample_count >= 0)
+      quotas = sample_quotas(inputs, static_cast<size_t>(sample_count));
+
+    auto parse_input = [&](CsvReader &r, size_t parse_threads, size_t shard) {
+      if (sample_count >= 0) {
+        r.parse_sample(delim, quotas[shard], seed + shard);
+      } else if (tail_only) {
+        r.parse_tail(delim, static_cast<size_t>(tail_count), parse_threads);
+      } else if (needs_full) {
+        // Sorting revisits the key column O(n log n) times, so materialize
+        // the field index; every other full pass only touches the columns
+        // it reads and is served by the lazy row index.
+        if (!sort_col.empty())
+          r.parse(delim, parse_threads);
+        else
+          r.parse_lazy(delim, parse_threads);
+      } else {
+        size_t limit =
+            (head_count >= 0) ? static_cast<size_t>(head_count) : 50;
+        size_t parse_count = std::max(limit, static_cast<size_t>(100));
+        r.parse_head(delim, parse_count, parse_threads);
+      }
+    };
 
-    if (needs_full) {
-      reader.parse(delim);
+    if (have_index && sort_col.empty()) {
+      reader.load_lazy(delim, index.rows);
+    } else if (write_index) {
+      reader.parse_lazy(delim, threads);
+    } else if (!sharded) {
+      parse_input(reader, threads, 0);
     } else {
-      size_t limit = (head_count >= 0) ? static_cast<size_t>(head_count) : 50;
-      size_t parse_count = std::max(limit, static_cast<size_t>(100));
-      reader.parse_head(delim, parse_count);
+      // One reader per shard, opened and parsed the same way on a pool of
+      // workers; the first reader then adopts the others' rows in argument
+      // order. Each shard's tail or head is enough for the whole table's.
+      std::vector<std::unique_ptr<CsvReader>> shards(inputs.size() - 1);
+      size_t per_shard = std::max<size_t>(1, threads / inputs.size());
+      std::atomic<size_t> next{0};
+      run_parallel(std::min(threads, inputs.size()), [&](size_t) {
+        for (size_t i; (i = next++) < inputs.size();) {
+          if (i == 0) {
+            parse_input(reader, per_shard, 0);
+            continue;
+          }
+          shards[i - 1] = std::make_unique<CsvReader>(inputs[i].c_str(), io);
+          parse_input(*shards[i - 1], per_shard, i);
+        }
+      });
+      std::vector<std::string> columns(reader.headers().begin(),
+                                       reader.headers().end());
+      for (size_t i = 1; i < inputs.size(); ++i) {
+        if (!same_columns(columns, *shards[i - 1])) {
+          std::cerr << "Error: " << inputs[i]
+                    << " has different columns than " << input_path << "\n";
+          return 1;
+        }
+      }
+      reader.append(std::move(shards));
     }
 
     if (reader.column_count() == 0) {
@@ -165,7 +587,15 @@ int main(int argc, char *argv[]) {
       return 1;
     }
 
-    auto schema = infer_schema(reader);
+    auto schema = exact_schema ? infer_schema_exact(reader, threads)
+                  : have_index ? index.schema
+                               : infer_schema(reader, infer_rows);
+
+    if (write_index) {
+      write_sidecar(input_path, reader, delim, schema, threads);
+      if (!sort_col.empty())
+        reader.parse(delim, threads);
+    }
 
     // Resolve column selection
     std::vector<size_t> col_indices;
@@ -180,13 +610,20 @@ int main(int argc, char *argv[]) {
     const std::vector<size_t> *row_ptr = nullptr;
     size_t match_count = reader.total_rows();
 
+    FilterExpr where = parse_where(where_exprs, or_logic);
+
+    // Filter and sort columns are decoded to typed values once, up front,
+    // instead of being re-parsed from text for every comparison
+    std::unique_ptr<ColumnStore> typed;
+    if (!where_exprs.empty() || !sort_col.empty())
+      typed = std::make_unique<ColumnStore>(
+          reader, schema,
+          referenced_columns(reader, where, sort_col, ignore_case),
+          threads);
+
     if (!where_exprs.empty()) {
-      std::vector<Filter> filters;
-      filters.reserve(where_exprs.size());
-      for (auto &expr : where_exprs)
-        filters.push_back(parse_filter(expr));
-      filtered =
-          apply_filters(filters, reader, schema, ignore_case, or_logic);
+      filtered = apply_filters(where, reader, schema, ignore_case, typed.get(),
+                               threads);
       row_ptr = &filtered;
       match_count = filtered.size();
     }
@@ -198,7 +635,8 @@ int main(int argc, char *argv[]) {
         std::iota(filtered.begin(), filtered.end(), static_cast<size_t>(0));
         row_ptr = &filtered;
       }
-      sort_indices(filtered, reader, schema, sort_col, sort_desc);
+      sort_indices(filtered, reader, schema, sort_col, sort_desc,
+                   typed.get());
     }
 
     // Apply tail (take last N)
@@ -222,8 +660,8 @@ int main(int argc, char *argv[]) {
     size_t max_rows;
     if (head_count >= 0)
       max_rows = static_cast<size_t>(head_count);
-    else if (tail_count >= 0)
-      max_rows = display_total; // tail already limited
+    else if (tail_count >= 0 || sample_count >= 0)
+      max_rows = display_total; // tail or sample already limited
     else if (interactive)
       max_rows = display_total; // pager shows all
     else
@@ -234,7 +672,14 @@ int main(int argc, char *argv[]) {
     if (count_mode) {
       std::cout << match_count << "\n";
     } else if (schema_mode) {
-      render_schema_json(schema, col_ptr, match_count, reader.size());
+      // A sidecar's statistics cover every row under its own schema
+      std::vector<ColumnStats> stats;
+      if (stats_mode && have_index && !exact_schema && !row_ptr)
+        stats = index.stats;
+      else if (stats_mode)
+        stats = compute_column_stats(reader, schema, threads, row_ptr);
+      render_schema_json(schema, col_ptr, match_count, reader.input_size(),
+                         stats_mode ? &stats : nullptr);
     } else if (format == OutputFormat::Csv) {
       render_csv(reader, row_ptr, col_ptr, max_rows, ',');
     } else if (format == OutputFormat::Tsv) {
@@ -0,0 +1,189 @@
+#include "include/numeric.hpp"
+#include "include/csv_reader.hpp"
+#include "include/parallel.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+
+// Floating-point from_chars is missing from libc++ before LLVM 20
+// (AppleClang); strtod_l in the C locale stands in for it there
+#if !defined(__cpp_lib_to_chars) || __cpp_lib_to_chars < 201611L
+#define GLANCE_STRTOD_FALLBACK 1
+#include <cerrno>
+#include <clocale>
+#include <cstdlib>
+#include <cstring>
+#ifdef __APPLE__
+#include <xlocale.h>
+#endif
+#endif
+
+bool parse_int64(std::string_view s, int64_t &value) {
+  // from_chars takes a minus sign but not a plus
+  if (!s.empty() && s[0] == '+') {
+    s.remove_prefix(1);
+    if (s.empty() || s[0] < '0' || s[0] > '9')
+      return false;
+  }
+  const char *end = s.data() + s.size();
+  auto [ptr, ec] = std::from_chars(s.data(), end, value);
+  return ec == std::errc() && ptr == end;
+}
+
+// Longest number parse_number reads, separators and symbols removed
+static constexpr size_t kMaxNumberBytes = 128;
+
+// Whether [first, last) is exactly one double, like from_chars in its
+// general format; callers have already ruled out inf, nan and hex
+static bool read_double(const char *first, const char *last, double &value) {
+#ifndef GLANCE_STRTOD_FALLBACK
+  auto [ptr, ec] = std::from_chars(first, last, value);
+  return ec == std::errc() && ptr == last;
+#else
+  // strtod_l needs a terminated copy; it also reads hex, spaces and a
+  // leading '+', which from_chars does not
+  size_t n = static_cast<size_t>(last - first);
+  if (n == 0 || n > kMaxNumberBytes || *first == '+' ||
+      std::string_view(first, n).find_first_not_of("0123456789.eE+-") !=
+          std::string_view::npos)
+    return false;
+  char buf[kMaxNumberBytes + 1];
+  std::memcpy(buf, first, n);
+  buf[n] = '\0';
+  static const locale_t c_locale = newlocale(LC_ALL_MASK, "C", nullptr);
+  char *end = nullptr;
+  errno = 0;
+  value = strtod_l(buf, &end, c_locale);
+  return errno != ERANGE && end == buf + n;
+#endif
+}
+
+// Whether s, after an optional '-', starts with a digit or point: rules
+// out inf, nan and a second sign
+static bool leads_with_digit(std::string_view s) {
+  if (!s.empty() && s[0] == '-')
+    s.remove_prefix(1);
+  return !s.empty() && (s[0] == '.' || (s[0] >= '0' && s[0] <= '9'));
+}
+
+bool parse_float64(std::string_view s, double &value) {
+  if (!s.empty() && s[0] == '+') {
+    s.remove_prefix(1);
+    if (s.empty() || s[0] == '-')
+      return false;
+  }
+  if (!leads_with_digit(s))
+    return false;
+  return read_double(s.data(), s.data() + s.size(), value);
+}
+
+// Length of the currency symbol at the start of s, or 0
+static size_t symbol_size(std::string_view s) {
+  if (!s.empty() && s[0] == '$')
+    return 1;
+  if (s.starts_with("\xc2\xa3") || s.starts_with("\xc2\xa5"))
+    return 2;
+  if (s.starts_with("\xe2\x82\xac"))
+    return 3;
+  return 0;
+}
+
+// Sets i past the currency symbol and sign at the start of s, in either
+// order; false when a second sign follows them
+static bool skip_symbol_and_sign(std::string_view s, size_t &i,
+                                 bool &negative) {
+  size_t symbol = symbol_size(s);
+  i = symbol;
+  negative = false;
+  if (i < s.size() && (s[i] == '-' || s[i] == '+')) {
+    negative = s[i++] == '-';
+    if (symbol == 0)
+      i += symbol_size(s.substr(i));
+  }
+  return i == s.size() || (s[i] != '-' && s[i] != '+');
+}
+
+bool parse_currency_cents(std::string_view s, int64_t &cents) {
+  size_t i = 0;
+  bool negative = false;
+  if (!skip_symbol_and_sign(s, i, negative))
+    return false;
+
+  // Thousands separators may sit anywhere before the point; at most two
+  // decimals are exact
+  int64_t units = 0;
+  int digits = 0;
+  int decimals = -1;
+  for (; i < s.size(); ++i) {
+    char c = s[i];
+    if (c >= '0' && c <= '9') {
+      if (decimals >= 2 || ++digits > 17)
+        return false;
+      units = units * 10 + (c - '0');
+      if (decimals >= 0)
+        ++decimals;
+    } else if (c == '.' && decimals < 0) {
+      decimals = 0;
+    } else if (c != ',' || decimals >= 0) {
+      return false;
+    }
+  }
+  if (digits == 0)
+    return false;
+  for (int d = std::max(decimals, 0); d < 2; ++d)
+    units *= 10;
+  cents = negative ? -units : units;
+  return true;
+}
+
+bool parse_number(std::string_view s, double &value) {
+  while (!s.empty() && s.front() == ' ')
+    s.remove_prefix(1);
+  while (!s.empty() && s.back() == ' ')
+    s.remove_suffix(1);
+
+  // Copy what from_chars reads into a stack buffer: the sign, then the
+  // digits, point and exponent without their separators
+  char buf[kMaxNumberBytes];
+  size_t n = 0;
+  size_t i = 0;
+  bool negative = false;
+  if (!skip_symbol_and_sign(s, i, negative))
+    return false;
+  if (negative)
+    buf[n++] = '-';
+  bool digits = false;
+  for (; i < s.size(); ++i) {
+    char c = s[i];
+    if (c == ',')
+      continue;
+    if (n == kMaxNumberBytes)
+      return false;
+    digits |= c >= '0' && c <= '9';
+    buf[n++] = c;
+  }
+  if (!digits || !leads_with_digit(std::string_view(buf, n)))
+    return false;
+  return read_double(buf, buf + n, value);
+}
+
+std::vector<double> parse_number_column(const CsvReader &reader, size_t col,
+                                        const std::vector<size_t> *rows,
+                                        size_t threads) {
+  std::vector<double> values(reader.row_count(), std::nan(""));
+  size_t count = rows ? rows->size() : reader.row_count();
+  size_t n = threads_for(count, threads);
+  run_parallel(n, [&](size_t t) {
+    for (size_t k = part_begin(count, n, t), end = part_begin(count, n, t + 1);
+         k < end; ++k) {
+      size_t r = rows ? (*rows)[k] : k;
+      auto row = reader.row(r);
+      if (col >= row.size())
+        continue;
+      double d;
+      if (parse_number(strip_quotes(row[col]), d))
+        values[r] = d;
+    }
+  });
+  return values;
+}
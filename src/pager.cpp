@@ -1,4 +1,5 @@
 #include "include/pager.hpp"
+#include "include/text_search.hpp"
 #include <algorithm>
 #include <cerrno>
 #include <cstdint>
@@ -239,33 +240,27 @@ static void do_search(PagerState &st, const CsvReader &reader,
   if (st.search_query.empty())
     return;
 
-  // Case-insensitive search
-  std::string query_lower;
-  query_lower.reserve(st.search_query.size());
-  for (char c : st.search_query)
-    query_lower += static_cast<char>(c >= 'A' && c <= 'Z' ? c + 32 : c);
-
+  // Case-insensitive search of the visible columns, in column order
+  TextMatcher query(st.search_query, true);
   size_t ncols = reader.column_count();
+  std::vector<size_t> cols;
+  for (size_t ci = 0; ci < ncols; ++ci)
+    if (!col_indices || std::find(col_indices->begin(), col_indices->end(),
+                                  ci) != col_indices->end())
+      cols.push_back(ci);
+
   for (size_t d = 0; d < st.data_rows; ++d) {
     size_t actual = row_indices ? (*row_indices)[d] : d;
     auto row = reader.row(actual);
-    for (size_t ci = 0; ci < ncols; ++ci) {
-      if (col_indices) {
-        bool visible = false;
-        for (auto idx : *col_indices)
-          if (idx == ci) {
-            visible = true;
-            break;
-          }
-        if (!visible)
-          continue;
-      }
-      std::string val = unquote(row[ci]);
-      // to lower
-      for (char &ch : val)
-        if (ch >= 'A' && ch <= 'Z')
-          ch += 32;
-      if (val.find(query_lower) != std::string::npos) {
+    for (size_t ci : cols) {
+      // Fields are searched in place; only escaped quotes need a copy
+      auto field = row[ci];
+      std::string_view val = strip_quotes(field);
+      bool hit = val.size() != field.size() &&
+                         val.find('"') != std::string_view::npos
+                     ? query.contains(unquote(field))
+                     : query.contains(val);
+      if (hit) {
         st.search_hits.push_back(d);
         break;
       }
@@ -437,7 +432,7 @@ static void render(const PagerState &st, const CsvReader &reader,
   size_t display_ncols =
       col_indices ? col_indices->size() : reader.column_count();
   std::string right = std::to_string(display_ncols) + " cols | " +
-                       format_size(reader.size()) +
+                       format_size(reader.input_size()) +
                        " | \xe2\x86\x91\xe2\x86\x93 scroll  "  // ↑↓
                        "\xe2\x86\x90\xe2\x86\x91 cols  "        // ←→
                        "/ search  q quit";
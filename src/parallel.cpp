@@ -0,0 +1,6 @@
+#include "include/parallel.hpp"
+
+size_t default_thread_count() {
+  unsigned n = std::thread::hardware_concurrency();
+  return n > 0 ? static_cast<size_t>(n) : 1;
+}
@@ -0,0 +1,411 @@
+#include "include/sidecar.hpp"
+#include "include/csv_reader.hpp"
+#include "include/decompress.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Layout (native byte order, no padding):
+//   magic[8] version:u32
+//   file_size:u64 mtime_sec:i64 mtime_nsec:i64 header_hash:u64
+//   delimiter:u8 ncols:u64
+//   ncols x { type:u8 name_len:u32 name[name_len] }
+//   ncols x { nulls:u64 max_width:u64 distinct:u64 numbers:u64 mean:f64
+//             stddev:f64 min_len:u32 min[min_len] max_len:u32 max[max_len] }
+//   nrows:u64 nwide:u64 lengths:u32[nrows] advances:u32[nrows]
+//   nwide x { row:u64 offset:u64 length:u64 }
+// as CsvReader::load_lazy reads it (see PackedRows)
+static constexpr char kMagic[8] = {'G', 'L', 'A', 'N', 'C', 'E', 'I', 'X'};
+static constexpr uint32_t kVersion = 3;
+static constexpr size_t kMaxHeaderHash = 1 << 16;
+
+struct FileStamp {
+  uint64_t size = 0;
+  int64_t mtime_sec = 0;
+  int64_t mtime_nsec = 0;
+  uint64_t header_hash = 0;
+};
+
+// FNV-1a over the first line (capped), so a rewritten header invalidates
+// the index even if size and mtime happen to match.
+static uint64_t header_hash(const char *data, size_t size) {
+  size_t len = std::min(size, kMaxHeaderHash);
+  if (const void *nl = std::memchr(data, '\n', len))
+    len = static_cast<size_t>(static_cast<const char *>(nl) - data);
+  uint64_t h = 0xcbf29ce484222325ull;
+  for (size_t i = 0; i < len; ++i) {
+    h ^= static_cast<unsigned char>(data[i]);
+    h *= 0x100000001b3ull;
+  }
+  return h;
+}
+
+static bool stat_file(const std::string &path, FileStamp &out) {
+  struct stat sbuf;
+  if (stat(path.c_str(), &sbuf) < 0 || !S_ISREG(sbuf.st_mode))
+    return false;
+  out.size = static_cast<uint64_t>(sbuf.st_size);
+#ifdef __APPLE__
+  out.mtime_sec = static_cast<int64_t>(sbuf.st_mtimespec.tv_sec);
+  out.mtime_nsec = static_cast<int64_t>(sbuf.st_mtimespec.tv_nsec);
+#else
+  out.mtime_sec = static_cast<int64_t>(sbuf.st_mtim.tv_sec);
+  out.mtime_nsec = static_cast<int64_t>(sbuf.st_mtim.tv_nsec);
+#endif
+  return true;
+}
+
+static bool stamp_file(const std::string &csv_path, const CsvReader &reader,
+                       FileStamp &out) {
+  if (!stat_file(csv_path, out))
+    return false;
+  out.header_hash = header_hash(reader.data(), reader.size());
+  return out.size == reader.size();
+}
+
+// A compressed file's "header" is its leading compressed bytes
+static bool stamp_compressed(const std::string &path, FileStamp &out) {
+  if (!stat_file(path, out))
+    return false;
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  std::string head(std::min<uint64_t>(out.size, kMaxHeaderHash), '\0');
+  ssize_t n = pread(fd, head.data(), head.size(), 0);
+  close(fd);
+  if (n != static_cast<ssize_t>(head.size()))
+    return false;
+  out.header_hash = header_hash(head.data(), head.size());
+  return true;
+}
+
+static bool same_stamp(const FileStamp &a, const FileStamp &b) {
+  return a.size == b.size && a.mtime_sec == b.mtime_sec &&
+         a.mtime_nsec == b.mtime_nsec && a.header_hash == b.header_hash;
+}
+
+std::string sidecar_path(const std::string &csv_path) {
+  return csv_path + ".glance-idx";
+}
+
+// --- Serialization ---
+
+template <typename T> static void put(std::string &buf, const T &v) {
+  buf.append(reinterpret_cast<const char *>(&v), sizeof(T));
+}
+
+static void put_stamp(std::string &buf, const FileStamp &stamp) {
+  put(buf, stamp.size);
+  put(buf, stamp.mtime_sec);
+  put(buf, stamp.mtime_nsec);
+  put(buf, stamp.header_hash);
+}
+
+// Writes to a unique temporary name next to path and renames, so readers
+// never see a torn file and concurrent writers do not share a temporary
+static void write_atomically(const std::string &path, const std::string &buf) {
+  std::string tmp = path + ".XXXXXX";
+  int fd = mkstemp(tmp.data());
+  if (fd < 0)
+    throw std::runtime_error("Failed to create index file");
+  fchmod(fd, 0644);
+  size_t done = 0;
+  while (done < buf.size()) {
+    ssize_t n = ::write(fd, buf.data() + done, buf.size() - done);
+    if (n <= 0)
+      break;
+    done += static_cast<size_t>(n);
+  }
+  bool closed = close(fd) == 0;
+  if (done != buf.size() || !closed ||
+      std::rename(tmp.c_str(), path.c_str()) != 0) {
+    std::remove(tmp.c_str());
+    throw std::runtime_error("Failed to write index file");
+  }
+}
+
+void write_sidecar(const std::string &csv_path, const CsvReader &reader,
+                   char delimiter, const std::vector<ColumnSchema> &schema,
+                   size_t threads) {
+  if (!reader.lazy())
+    throw std::runtime_error("Sidecar index needs a lazy row index");
+  FileStamp stamp;
+  if (!stamp_file(csv_path, reader, stamp))
+    throw std::runtime_error("Cannot index a non-regular file");
+
+  auto stats = compute_column_stats(reader, schema, threads);
+  size_t nrows = reader.row_count();
+
+  std::string buf;
+  buf.reserve(64 + schema.size() * 32 + nrows * 8);
+  buf.append(kMagic, sizeof(kMagic));
+  put(buf, kVersion);
+  put_stamp(buf, stamp);
+  put(buf, static_cast<uint8_t>(delimiter));
+  put(buf, static_cast<uint64_t>(schema.size()));
+  for (auto &col : schema) {
+    put(buf, static_cast<uint8_t>(col.type));
+    put(buf, static_cast<uint32_t>(col.name.size()));
+    buf += col.name;
+  }
+  for (auto &s : stats) {
+    put(buf, s.nulls);
+    put(buf, s.max_width);
+    put(buf, s.distinct);
+    put(buf, s.numbers);
+    put(buf, s.mean);
+    put(buf, s.stddev);
+    for (const std::string *text : {&s.min, &s.max}) {
+      put(buf, static_cast<uint32_t>(text->size()));
+      buf += *text;
+    }
+  }
+  // Lengths the row table cannot hold inline, and starts more than 4 GB
+  // after the previous one, go to the wide list
+  std::string lengths, advances, wide;
+  lengths.reserve(nrows * sizeof(uint32_t));
+  advances.reserve(nrows * sizeof(uint32_t));
+  const char *base = reader.data();
+  uint64_t prev = 0;
+  uint64_t nwide = 0;
+  for (size_t r = 0; r < nrows; ++r) {
+    auto span = reader.row_span(r);
+    uint64_t off = static_cast<uint64_t>(span.data() - base);
+    uint64_t len = span.size();
+    bool long_row = len >= RowView::kOffsetMask;
+    bool far = off - prev >= PackedRows::kWide;
+    put(lengths, long_row ? PackedRows::kWide : static_cast<uint32_t>(len));
+    put(advances, far ? PackedRows::kWide : static_cast<uint32_t>(off - prev));
+    if (long_row || far) {
+      put(wide, static_cast<uint64_t>(r));
+      put(wide, off);
+      put(wide, len);
+      ++nwide;
+    }
+    prev = off;
+  }
+  put(buf, static_cast<uint64_t>(nrows));
+  put(buf, nwide);
+  buf += lengths;
+  buf += advances;
+  buf += wide;
+
+  write_atomically(sidecar_path(csv_path), buf);
+}
+
+namespace {
+
+struct Cursor {
+  const char *p;
+  const char *end;
+
+  bool take(void *out, size_t n) {
+    if (static_cast<size_t>(end - p) < n)
+      return false;
+    std::memcpy(out, p, n);
+    p += n;
+    return true;
+  }
+  template <typename T> bool get(T &v) { return take(&v, sizeof(T)); }
+  bool get(std::string &s) {
+    uint32_t len = 0;
+    if (!get(len) || static_cast<size_t>(end - p) < len)
+      return false;
+    s.assign(p, len);
+    p += len;
+    return true;
+  }
+};
+
+} // namespace
+
+static bool parse_sidecar(Cursor in, const FileStamp &expected,
+                          SidecarIndex &out) {
+  char magic[sizeof(kMagic)];
+  uint32_t version = 0;
+  FileStamp stamp;
+  uint8_t delim = 0;
+  uint64_t ncols = 0;
+  if (!in.take(magic, sizeof(magic)) ||
+      std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 || !in.get(version) ||
+      version != kVersion || !in.get(stamp.size) ||
+      !in.get(stamp.mtime_sec) || !in.get(stamp.mtime_nsec) ||
+      !in.get(stamp.header_hash) || !in.get(delim) || !in.get(ncols))
+    return false;
+  if (!same_stamp(stamp, expected))
+    return false;
+  if (ncols > static_cast<uint64_t>(in.end - in.p))
+    return false;
+
+  out.delimiter = static_cast<char>(delim);
+  out.schema.resize(ncols);
+  for (auto &col : out.schema) {
+    uint8_t type = 0;
+    uint32_t len = 0;
+    if (!in.get(type) || type > static_cast<uint8_t>(ColumnType::Text) ||
+        !in.get(len) || static_cast<size_t>(in.end - in.p) < len)
+      return false;
+    col.type = static_cast<ColumnType>(type);
+    col.name.assign(in.p, len);
+    in.p += len;
+  }
+  out.stats.resize(ncols);
+  for (auto &s : out.stats)
+    if (!in.get(s.nulls) || !in.get(s.max_width) || !in.get(s.distinct) ||
+        !in.get(s.numbers) || !in.get(s.mean) || !in.get(s.stddev) ||
+        !in.get(s.min) || !in.get(s.max))
+      return false;
+
+  // The rows themselves are checked once, by load_lazy
+  uint64_t nrows = 0, nwide = 0;
+  if (!in.get(nrows) || !in.get(nwide))
+    return false;
+  uint64_t left = static_cast<uint64_t>(in.end - in.p);
+  constexpr uint64_t kRowBytes = 2 * sizeof(uint32_t);
+  constexpr uint64_t kWideBytes = 3 * sizeof(uint64_t);
+  if (nrows > left / kRowBytes || nwide > nrows ||
+      nwide * kWideBytes != left - nrows * kRowBytes)
+    return false;
+  out.rows.count = nrows;
+  out.rows.lengths = in.p;
+  out.rows.advances = in.p + nrows * sizeof(uint32_t);
+  out.rows.wide_count = nwide;
+  out.rows.wide = in.p + nrows * kRowBytes;
+  return true;
+}
+
+// Maps the index file next to path; null if it is missing or empty
+static std::shared_ptr<const char> map_index_file(const std::string &path,
+                                                  size_t &size) {
+  int fd = open(sidecar_path(path).c_str(), O_RDONLY);
+  if (fd < 0)
+    return nullptr;
+  struct stat sbuf;
+  if (fstat(fd, &sbuf) < 0 || sbuf.st_size <= 0) {
+    close(fd);
+    return nullptr;
+  }
+  size = static_cast<size_t>(sbuf.st_size);
+  void *addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED)
+    return nullptr;
+  return {static_cast<const char *>(addr),
+          [size](const char *p) { munmap(const_cast<char *>(p), size); }};
+}
+
+bool load_sidecar(const std::string &csv_path, const CsvReader &reader,
+                  SidecarIndex &out) {
+  FileStamp stamp;
+  if (!stamp_file(csv_path, reader, stamp))
+    return false;
+  size_t size = 0;
+  auto mapping = map_index_file(csv_path, size);
+  SidecarIndex index;
+  if (!mapping ||
+      !parse_sidecar(Cursor{mapping.get(), mapping.get() + size}, stamp,
+                     index))
+    return false;
+  index.mapping = std::move(mapping);
+  out = std::move(index);
+  return true;
+}
+
+// --- Compressed seek index ---
+
+// Layout (native byte order, no padding):
+//   magic[8] version:u32
+//   file_size:u64 mtime_sec:i64 mtime_nsec:i64 header_hash:u64
+//   type:u8 total_out:u64 npoints:u64
+//   npoints x { out:u64 in:u64 bits:u8 in_quotes:u8 row_start:u8
+//               window_len:u32 window[window_len] }
+static constexpr char kSeekMagic[8] = {'G', 'L', 'A', 'N', 'C', 'E', 'Z', 'X'};
+static constexpr uint32_t kSeekVersion = 2;
+
+void write_seek_index(const std::string &path, const SeekIndex &index) {
+  FileStamp stamp;
+  if (!stamp_compressed(path, stamp))
+    throw std::runtime_error("Cannot index a non-regular file");
+
+  std::string buf;
+  buf.append(kSeekMagic, sizeof(kSeekMagic));
+  put(buf, kSeekVersion);
+  put_stamp(buf, stamp);
+  put(buf, static_cast<uint8_t>(index.type));
+  put(buf, index.total_out);
+  put(buf, static_cast<uint64_t>(index.points.size()));
+  for (auto &point : index.points) {
+    put(buf, point.out);
+    put(buf, point.in);
+    put(buf, point.bits);
+    put(buf, static_cast<uint8_t>(point.in_quotes));
+    put(buf, static_cast<uint8_t>(point.row_start));
+    put(buf, static_cast<uint32_t>(point.window.size()));
+    buf += point.window;
+  }
+  write_atomically(sidecar_path(path), buf);
+}
+
+static bool parse_seek_index(Cursor in, const FileStamp &expected,
+                             SeekIndex &out) {
+  char magic[sizeof(kSeekMagic)];
+  uint32_t version = 0;
+  FileStamp stamp;
+  uint8_t type = 0;
+  uint64_t npoints = 0;
+  if (!in.take(magic, sizeof(magic)) ||
+      std::memcmp(magic, kSeekMagic, sizeof(kSeekMagic)) != 0 ||
+      !in.get(version) || version != kSeekVersion || !in.get(stamp.size) ||
+      !in.get(stamp.mtime_sec) || !in.get(stamp.mtime_nsec) ||
+      !in.get(stamp.header_hash) || !in.get(type) || !in.get(out.total_out) ||
+      !in.get(npoints))
+    return false;
+  if (!same_stamp(stamp, expected) ||
+      (type != static_cast<uint8_t>(Compression::Gzip) &&
+       type != static_cast<uint8_t>(Compression::Zstd)) ||
+      npoints == 0 || npoints > static_cast<uint64_t>(in.end - in.p))
+    return false;
+
+  out.type = static_cast<Compression>(type);
+  out.points.resize(npoints);
+  uint64_t prev = 0;
+  for (auto &point : out.points) {
+    uint8_t in_quotes = 0, row_start = 0;
+    uint32_t len = 0;
+    if (!in.get(point.out) || !in.get(point.in) || !in.get(point.bits) ||
+        !in.get(in_quotes) || !in.get(row_start) || !in.get(len) ||
+        static_cast<size_t>(in.end - in.p) < len)
+      return false;
+    if (point.out < prev || point.out > out.total_out ||
+        point.in > stamp.size || point.bits > 7 ||
+        (point.bits && point.in == 0))
+      return false;
+    point.in_quotes = in_quotes != 0;
+    point.row_start = row_start != 0;
+    point.window.assign(in.p, len);
+    in.p += len;
+    prev = point.out;
+  }
+  return out.points.front().out == 0 && in.p == in.end;
+}
+
+bool load_seek_index(const std::string &path, SeekIndex &out) {
+  FileStamp stamp;
+  if (!stamp_compressed(path, stamp))
+    return false;
+  size_t size = 0;
+  auto mapping = map_index_file(path, size);
+  SeekIndex index;
+  if (!mapping ||
+      !parse_seek_index(Cursor{mapping.get(), mapping.get() + size}, stamp,
+                        index))
+    return false;
+  out = std::move(index);
+  return true;
+}
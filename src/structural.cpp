@@ -0,0 +1,234 @@
+#include "include/structural.hpp"
+#include <cstring>
+
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#elif defined(__AVX2__) || defined(__PCLMUL__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// --- Block classification (64 bytes → one bit per byte) ---
+
+struct BlockMasks {
+  uint64_t quote;
+  uint64_t delim;
+  uint64_t newline;
+  uint64_t cr;
+};
+
+#ifdef __ARM_NEON
+static inline uint64_t neon_movemask(uint8x16_t m0, uint8x16_t m1,
+                                     uint8x16_t m2, uint8x16_t m3) {
+  const uint8x16_t bits = {0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80,
+                           0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80};
+  uint8x16_t s0 = vpaddq_u8(vandq_u8(m0, bits), vandq_u8(m1, bits));
+  uint8x16_t s1 = vpaddq_u8(vandq_u8(m2, bits), vandq_u8(m3, bits));
+  s0 = vpaddq_u8(s0, s1);
+  s0 = vpaddq_u8(s0, s0);
+  return vgetq_lane_u64(vreinterpretq_u64_u8(s0), 0);
+}
+#endif
+
+static inline BlockMasks classify64(const char *p, char delim) {
+  BlockMasks m;
+#ifdef __ARM_NEON
+  const uint8_t *u = reinterpret_cast<const uint8_t *>(p);
+  uint8x16_t c0 = vld1q_u8(u), c1 = vld1q_u8(u + 16);
+  uint8x16_t c2 = vld1q_u8(u + 32), c3 = vld1q_u8(u + 48);
+  auto eq = [&](uint8_t ch) {
+    uint8x16_t v = vdupq_n_u8(ch);
+    return neon_movemask(vceqq_u8(c0, v), vceqq_u8(c1, v), vceqq_u8(c2, v),
+                         vceqq_u8(c3, v));
+  };
+  m.quote = eq('"');
+  m.delim = eq(static_cast<uint8_t>(delim));
+  m.newline = eq('\n');
+  m.cr = eq('\r');
+#elif defined(__AVX2__)
+  __m256i c0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+  __m256i c1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + 32));
+  auto eq = [&](char ch) {
+    __m256i v = _mm256_set1_epi8(ch);
+    uint64_t lo = static_cast<uint32_t>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(c0, v)));
+    uint64_t hi = static_cast<uint32_t>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(c1, v)));
+    return lo | (hi << 32);
+  };
+  m.quote = eq('"');
+  m.delim = eq(delim);
+  m.newline = eq('\n');
+  m.cr = eq('\r');
+#elif defined(__SSE2__)
+  __m128i c[4];
+  for (int k = 0; k < 4; ++k)
+    c[k] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 16 * k));
+  auto eq = [&](char ch) {
+    __m128i v = _mm_set1_epi8(ch);
+    uint64_t r = 0;
+    for (int k = 0; k < 4; ++k)
+      r |= static_cast<uint64_t>(static_cast<uint16_t>(
+               _mm_movemask_epi8(_mm_cmpeq_epi8(c[k], v))))
+           << (16 * k);
+    return r;
+  };
+  m.quote = eq('"');
+  m.delim = eq(delim);
+  m.newline = eq('\n');
+  m.cr = eq('\r');
+#else
+  m = {0, 0, 0, 0};
+  for (int i = 0; i < 64; ++i) {
+    uint64_t bit = uint64_t{1} << i;
+    // Independent tests, like the SIMD compares: delim may be '\n'
+    if (p[i] == '"')
+      m.quote |= bit;
+    if (p[i] == delim)
+      m.delim |= bit;
+    if (p[i] == '\n')
+      m.newline |= bit;
+    if (p[i] == '\r')
+      m.cr |= bit;
+  }
+#endif
+  return m;
+}
+
+// Classifies len (<= 64) bytes; bits at and beyond len are zero.
+static inline BlockMasks classify_block(const char *p, size_t len,
+                                        char delim) {
+  if (len == 64)
+    return classify64(p, delim);
+  char buf[64] = {};
+  std::memcpy(buf, p, len);
+  return classify64(buf, delim);
+}
+
+// --- In-quote mask ---
+
+uint64_t prefix_xor(uint64_t bits) {
+#if defined(__PCLMUL__)
+  __m128i v = _mm_set_epi64x(0, static_cast<long long>(bits));
+  __m128i ones = _mm_set1_epi8(static_cast<char>(0xFF));
+  return static_cast<uint64_t>(
+      _mm_cvtsi128_si64(_mm_clmulepi64_si128(v, ones, 0)));
+#elif defined(__ARM_NEON) && defined(__ARM_FEATURE_AES)
+  return static_cast<uint64_t>(vmull_p64(bits, ~uint64_t{0}));
+#else
+  bits ^= bits << 1;
+  bits ^= bits << 2;
+  bits ^= bits << 4;
+  bits ^= bits << 8;
+  bits ^= bits << 16;
+  bits ^= bits << 32;
+  return bits;
+#endif
+}
+
+// All ones when the top bit is set, otherwise zero.
+static inline uint64_t carry_of(uint64_t mask) {
+  return static_cast<uint64_t>(static_cast<int64_t>(mask) >> 63);
+}
+
+// --- Row boundary search ---
+
+size_t find_row_end(const char *base, size_t total, size_t start,
+                    bool in_quotes) {
+  uint64_t carry = in_quotes ? ~uint64_t{0} : 0;
+  for (size_t i = start; i < total; i += 64) {
+    size_t len = std::min(static_cast<size_t>(64), total - i);
+    BlockMasks m = classify_block(base + i, len, '\n');
+    uint64_t inq = prefix_xor(m.quote) ^ carry;
+    uint64_t nl = m.newline & ~inq;
+    if (nl)
+      return i + static_cast<size_t>(__builtin_ctzll(nl));
+    carry = carry_of(inq);
+  }
+  return total;
+}
+
+bool find_row_ends(const char *base, size_t begin, size_t end, bool in_quotes,
+                   std::vector<size_t> &out) {
+  uint64_t carry = in_quotes ? ~uint64_t{0} : 0;
+  for (size_t i = begin; i < end; i += 64) {
+    size_t len = std::min(static_cast<size_t>(64), end - i);
+    BlockMasks m = classify_block(base + i, len, '\n');
+    uint64_t inq = prefix_xor(m.quote) ^ carry;
+    uint64_t nl = m.newline & ~inq;
+    while (nl) {
+      out.push_back(i + static_cast<size_t>(__builtin_ctzll(nl)));
+      nl &= nl - 1;
+    }
+    // Quote bits past len are zero, so bit 63 holds the state at end
+    carry = carry_of(inq);
+  }
+  return carry != 0;
+}
+
+RowEndCount count_row_ends(const char *data, size_t len) {
+  RowEndCount r;
+  uint64_t carry = 0;
+  for (size_t i = 0; i < len; i += 64) {
+    size_t n = std::min(static_cast<size_t>(64), len - i);
+    BlockMasks m = classify_block(data + i, n, '\n');
+    uint64_t inq = prefix_xor(m.quote) ^ carry;
+    r.outside += static_cast<size_t>(__builtin_popcountll(m.newline & ~inq));
+    r.newlines += static_cast<size_t>(__builtin_popcountll(m.newline));
+    carry = carry_of(inq);
+  }
+  r.odd_quotes = carry != 0;
+  return r;
+}
+
+// --- Structural index ---
+
+void StructuralIndex::build(const char *base, size_t begin, size_t end,
+                            char delim) {
+  size_t len = end - begin;
+  positions_.clear();
+  positions_.reserve(len);
+  dirty_.clear();
+  dirty_.reserve(len / 64 + 1);
+
+  uint64_t in_carry = 0;       // quote state entering the block
+  uint64_t struct_carry = 1;   // previous byte was structural (row start)
+  uint64_t close_carry = 0;    // previous byte was a closing quote
+  uint64_t cr_close_carry = 0; // previous byte was \r right after a close
+
+  for (size_t off = 0; off < len; off += 64) {
+    size_t n = std::min(static_cast<size_t>(64), len - off);
+    uint64_t valid = (n == 64) ? ~uint64_t{0} : (uint64_t{1} << n) - 1;
+    BlockMasks m = classify_block(base + begin + off, n, delim);
+
+    uint64_t inq = prefix_xor(m.quote) ^ in_carry;
+    uint64_t opening = m.quote & inq;
+    uint64_t closing = m.quote & ~inq;
+    uint64_t structural = (m.delim | m.newline) & ~inq;
+
+    uint64_t after_struct = (structural << 1) | struct_carry;
+    uint64_t after_close = (closing << 1) | close_carry;
+    uint64_t cr_after_close = after_close & m.cr;
+    uint64_t after_cr = (cr_after_close << 1) | cr_close_carry;
+
+    // An opening quote must start a field or continue a "" escape; a closing
+    // quote must end the field (delimiter, newline, \r\n) or be escaped.
+    uint64_t bad = (opening & ~(after_struct | after_close)) |
+                   (after_close & ~(structural | opening | m.cr)) |
+                   (after_cr & ~m.newline);
+    dirty_.push_back((bad & valid) != 0);
+
+    uint64_t s = structural & valid;
+    while (s) {
+      positions_.push_back(
+          static_cast<uint32_t>(off + static_cast<size_t>(__builtin_ctzll(s))));
+      s &= s - 1;
+    }
+
+    in_carry = carry_of(inq);
+    struct_carry = structural >> 63;
+    close_carry = closing >> 63;
+    cr_close_carry = cr_after_close >> 63;
+  }
+}
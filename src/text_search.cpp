@@ -0,0 +1,158 @@
+#include "include/text_search.hpp"
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static char lower(char c) {
+  return static_cast<char>(c >= 'A' && c <= 'Z' ? c + 32 : c);
+}
+
+static char upper(char c) {
+  return static_cast<char>(c >= 'a' && c <= 'z' ? c - 32 : c);
+}
+
+bool equal_folded(const char *p, const char *lower_text, size_t n) {
+  size_t i = 0;
+#ifdef __ARM_NEON
+  uint8x16_t a = vdupq_n_u8('A'), z = vdupq_n_u8('Z'), bit = vdupq_n_u8(0x20);
+  for (; i + 16 <= n; i += 16) {
+    uint8x16_t x = vld1q_u8(reinterpret_cast<const uint8_t *>(p + i));
+    uint8x16_t letter = vandq_u8(vcgeq_u8(x, a), vcleq_u8(x, z));
+    x = vorrq_u8(x, vandq_u8(letter, bit));
+    uint8x16_t y = vld1q_u8(reinterpret_cast<const uint8_t *>(lower_text + i));
+    if (vminvq_u8(vceqq_u8(x, y)) != 0xFF)
+      return false;
+  }
+#elif defined(__SSE2__)
+  // Bytes above 0x7F compare as negative, so they are never letters
+  __m128i a = _mm_set1_epi8('A' - 1), z = _mm_set1_epi8('Z' + 1);
+  __m128i bit = _mm_set1_epi8(0x20);
+  for (; i + 16 <= n; i += 16) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+    __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(x, a), _mm_cmplt_epi8(x, z));
+    x = _mm_or_si128(x, _mm_and_si128(letter, bit));
+    __m128i y =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(lower_text + i));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) != 0xFFFF)
+      return false;
+  }
+#endif
+  for (; i < n; ++i)
+    if (lower(p[i]) != lower_text[i])
+      return false;
+  return true;
+}
+
+TextMatcher::TextMatcher(std::string_view needle, bool ignore_case)
+    : needle_(needle), ignore_case_(ignore_case) {
+  if (ignore_case_)
+    for (char &c : needle_)
+      c = lower(c);
+  if (needle_.empty())
+    return;
+  char first = needle_.front(), last = needle_.back();
+  first_[0] = first;
+  last_[0] = last;
+  first_[1] = ignore_case_ ? upper(first) : first;
+  last_[1] = ignore_case_ ? upper(last) : last;
+}
+
+bool TextMatcher::matches_at(const char *p) const {
+  return ignore_case_ ? equal_folded(p, needle_.data(), needle_.size())
+                      : std::memcmp(p, needle_.data(), needle_.size()) == 0;
+}
+
+size_t TextMatcher::find(std::string_view s) const {
+  size_t m = needle_.size();
+  if (m == 0)
+    return 0;
+  if (s.size() < m)
+    return npos;
+  const char *h = s.data();
+  size_t candidates = s.size() - m + 1; // positions the needle could start
+  size_t i = 0;
+
+  // Each lane i tests whether the needle could start at i: byte i against
+  // its first byte and byte i + m - 1 against its last
+#ifdef __ARM_NEON
+  uint8x16_t f0 = vdupq_n_u8(static_cast<uint8_t>(first_[0]));
+  uint8x16_t f1 = vdupq_n_u8(static_cast<uint8_t>(first_[1]));
+  uint8x16_t l0 = vdupq_n_u8(static_cast<uint8_t>(last_[0]));
+  uint8x16_t l1 = vdupq_n_u8(static_cast<uint8_t>(last_[1]));
+  for (; i + 16 <= candidates; i += 16) {
+    uint8x16_t a = vld1q_u8(reinterpret_cast<const uint8_t *>(h + i));
+    uint8x16_t b = vld1q_u8(reinterpret_cast<const uint8_t *>(h + i + m - 1));
+    uint8x16_t eq = vandq_u8(vorrq_u8(vceqq_u8(a, f0), vceqq_u8(a, f1)),
+                             vorrq_u8(vceqq_u8(b, l0), vceqq_u8(b, l1)));
+    // Four mask bits per lane
+    uint64_t mask = vget_lane_u64(
+        vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+    while (mask) {
+      auto bit = std::countr_zero(mask);
+      if (matches_at(h + i + bit / 4))
+        return i + bit / 4;
+      mask &= ~(uint64_t{0xF} << bit);
+    }
+  }
+#elif defined(__AVX2__)
+  __m256i f0 = _mm256_set1_epi8(first_[0]), f1 = _mm256_set1_epi8(first_[1]);
+  __m256i l0 = _mm256_set1_epi8(last_[0]), l1 = _mm256_set1_epi8(last_[1]);
+  for (; i + 32 <= candidates; i += 32) {
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(h + i));
+    __m256i b =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(h + i + m - 1));
+    __m256i eq = _mm256_and_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(a, f0), _mm256_cmpeq_epi8(a, f1)),
+        _mm256_or_si256(_mm256_cmpeq_epi8(b, l0), _mm256_cmpeq_epi8(b, l1)));
+    for (auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(eq)); mask;
+         mask &= mask - 1) {
+      size_t j = static_cast<size_t>(std::countr_zero(mask));
+      if (matches_at(h + i + j))
+        return i + j;
+    }
+  }
+#elif defined(__SSE2__)
+  __m128i f0 = _mm_set1_epi8(first_[0]), f1 = _mm_set1_epi8(first_[1]);
+  __m128i l0 = _mm_set1_epi8(last_[0]), l1 = _mm_set1_epi8(last_[1]);
+  for (; i + 16 <= candidates; i += 16) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(h + i));
+    __m128i b =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(h + i + m - 1));
+    __m128i eq = _mm_and_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(a, f0), _mm_cmpeq_epi8(a, f1)),
+        _mm_or_si128(_mm_cmpeq_epi8(b, l0), _mm_cmpeq_epi8(b, l1)));
+    for (auto mask = static_cast<uint32_t>(_mm_movemask_epi8(eq)); mask;
+         mask &= mask - 1) {
+      size_t j = static_cast<size_t>(std::countr_zero(mask));
+      if (matches_at(h + i + j))
+        return i + j;
+    }
+  }
+#endif
+
+  for (; i < candidates; ++i)
+    if ((h[i] == first_[0] || h[i] == first_[1]) && matches_at(h + i))
+      return i;
+  return npos;
+}
+
+bool TextMatcher::starts_with(std::string_view s) const {
+  return s.size() >= needle_.size() && matches_at(s.data());
+}
+
+bool TextMatcher::ends_with(std::string_view s) const {
+  return s.size() >= needle_.size() &&
+         matches_at(s.data() + s.size() - needle_.size());
+}
+
+bool TextMatcher::equals(std::string_view s) const {
+  return s.size() == needle_.size() && matches_at(s.data());
+}
@@ -1,6 +1,11 @@
 #include "include/tui.hpp"
+#include "include/column_stats.hpp"
+#include "include/columns.hpp"
 #include "include/csv_reader.hpp"
 #include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
@@ -170,13 +175,73 @@ void render_table(const CsvReader &reader,
   std::cout << format_count(total_match_count) << " rows";
   if (nrows < total_match_count)
     std::cout << " (showing " << nrows << ")";
-  std::cout << " | " << ncols << " cols | " << format_size(reader.size())
-            << "\n";
+  std::cout << " | " << ncols << " cols | "
+            << format_size(reader.input_size()) << "\n";
+}
+
+static std::string json_escape(const std::string &val) {
+  std::string result;
+  result.reserve(val.size());
+  for (char c : val) {
+    switch (c) {
+    case '"':
+      result += "\\\"";
+      break;
+    case '\\':
+      result += "\\\\";
+      break;
+    case '\n':
+      result += "\\n";
+      break;
+    case '\r':
+      result += "\\r";
+      break;
+    case '\t':
+      result += "\\t";
+      break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20) {
+        char buf[8];
+        snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned char>(c));
+        result += buf;
+      } else {
+        result += c;
+      }
+    }
+  }
+  return result;
+}
+
+static std::string json_number(double v) {
+  if (!std::isfinite(v))
+    return "null";
+  char buf[32];
+  auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), v);
+  return std::string(buf, end);
+}
+
+// A typed statistic as JSON: numbers for numeric columns, strings otherwise
+static std::string json_stat_value(ColumnType type, const std::string &text) {
+  int64_t i = 0;
+  double f = 0.0;
+  if (type == ColumnType::Int64 && parse_int64(text, i))
+    return std::to_string(i);
+  if (type == ColumnType::Float64 && parse_float64(text, f))
+    return json_number(f);
+  if (type == ColumnType::Currency && parse_currency_cents(text, i)) {
+    uint64_t cents = i < 0 ? 0 - static_cast<uint64_t>(i) : i;
+    char frac[4];
+    std::snprintf(frac, sizeof(frac), ".%02u",
+                  static_cast<unsigned>(cents % 100));
+    return (i < 0 ? "-" : "") + std::to_string(cents / 100) + frac;
+  }
+  return "\"" + json_escape(text) + "\"";
 }
 
 void render_schema_json(const std::vector<ColumnSchema> &schema,
                         const std::vector<size_t> *col_indices,
-                        size_t row_count, size_t file_size) {
+                        size_t row_count, size_t file_size,
+                        const std::vector<ColumnStats> *stats) {
   std::vector<size_t> cols;
   if (col_indices) {
     cols = *col_indices;
@@ -193,7 +258,20 @@ void render_schema_json(const std::vector<ColumnSchema> &schema,
   for (size_t i = 0; i < cols.size(); ++i) {
     size_t ac = cols[i];
     std::cout << "    {\"name\": \"" << schema[ac].name << "\", \"type\": \""
-              << type_name(schema[ac].type) << "\"}";
+              << type_name(schema[ac].type) << "\"";
+    if (stats && ac < stats->size()) {
+      const ColumnStats &s = (*stats)[ac];
+      ColumnType type = schema[ac].type;
+      std::cout << ", \"nulls\": " << s.nulls << ", \"distinct\": "
+                << s.distinct << ", \"max_width\": " << s.max_width;
+      if (!s.min.empty())
+        std::cout << ", \"min\": " << json_stat_value(type, s.min)
+                  << ", \"max\": " << json_stat_value(type, s.max);
+      if (s.numbers > 0)
+        std::cout << ", \"mean\": " << json_number(s.mean)
+                  << ", \"stddev\": " << json_number(s.stddev);
+    }
+    std::cout << "}";
     if (i + 1 < cols.size())
       std::cout << ",";
     std::cout << "\n";
@@ -226,22 +304,22 @@ static std::string csv_escape(const std::string &val, char delim) {
   return result;
 }
 
-void render_csv(const CsvReader &reader,
-                const std::vector<size_t> *row_indices,
-                const std::vector<size_t> *col_indices, size_t max_rows,
-                char delimiter) {
-  auto &headers = reader.headers();
-
-  std::vector<size_t> cols;
-  if (col_indices) {
-    cols = *col_indices;
-  } else {
-    cols.resize(reader.column_count());
-    for (size_t i = 0; i < cols.size(); ++i)
-      cols[i] = i;
-  }
+static std::vector<size_t>
+output_columns(const CsvReader &reader,
+               const std::vector<size_t> *col_indices) {
+  if (col_indices)
+    return *col_indices;
+  std::vector<size_t> cols(reader.column_count());
+  for (size_t i = 0; i < cols.size(); ++i)
+    cols[i] = i;
+  return cols;
+}
 
-  // Header
+void render_csv_header(const CsvReader &reader,
+                       const std::vector<size_t> *col_indices,
+                       char delimiter) {
+  auto &headers = reader.headers();
+  std::vector<size_t> cols = output_columns(reader, col_indices);
   for (size_t i = 0; i < cols.size(); ++i) {
     if (i > 0)
       std::cout << delimiter;
@@ -249,8 +327,13 @@ void render_csv(const CsvReader &reader,
     std::cout << csv_escape(hdr, delimiter);
   }
   std::cout << "\n";
+}
 
-  // Rows
+void render_csv_rows(const CsvReader &reader,
+                     const std::vector<size_t> *row_indices,
+                     const std::vector<size_t> *col_indices, size_t max_rows,
+                     char delimiter) {
+  std::vector<size_t> cols = output_columns(reader, col_indices);
   size_t available = row_indices ? row_indices->size() : reader.row_count();
   size_t nrows = std::min(available, max_rows);
 
@@ -268,64 +351,36 @@ void render_csv(const CsvReader &reader,
   }
 }
 
+void render_csv(const CsvReader &reader,
+                const std::vector<size_t> *row_indices,
+                const std::vector<size_t> *col_indices, size_t max_rows,
+                char delimiter) {
+  render_csv_header(reader, col_indices, delimiter);
+  render_csv_rows(reader, row_indices, col_indices, max_rows, delimiter);
+}
+
 // --- JSON output ---
 
-static std::string json_escape(const std::string &val) {
-  std::string result;
-  result.reserve(val.size());
-  for (char c : val) {
-    switch (c) {
-    case '"':
-      result += "\\\"";
-      break;
-    case '\\':
-      result += "\\\\";
-      break;
-    case '\n':
-      result += "\\n";
-      break;
-    case '\r':
-      result += "\\r";
-      break;
-    case '\t':
-      result += "\\t";
-      break;
-    default:
-      if (static_cast<unsigned char>(c) < 0x20) {
-        char buf[8];
-        snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned char>(c));
-        result += buf;
-      } else {
-        result += c;
-      }
-    }
-  }
-  return result;
-}
+void render_json_begin() { std::cout << "[\n"; }
 
-void render_json(const CsvReader &reader,
-                 const std::vector<ColumnSchema> &schema,
-                 const std::vector<size_t> *row_indices,
-                 const std::vector<size_t> *col_indices, size_t max_rows) {
+void render_json_rows(const CsvReader &reader,
+                      const std::vector<ColumnSchema> &schema,
+                      const std::vector<size_t> *row_indices,
+                      const std::vector<size_t> *col_indices, size_t max_rows,
+                      size_t &written) {
   auto &headers = reader.headers();
-
-  std::vector<size_t> cols;
-  if (col_indices) {
-    cols = *col_indices;
-  } else {
-    cols.resize(reader.column_count());
-    for (size_t i = 0; i < cols.size(); ++i)
-      cols[i] = i;
-  }
+  std::vector<size_t> cols = output_columns(reader, col_indices);
 
   size_t available = row_indices ? row_indices->size() : reader.row_count();
   size_t nrows = std::min(available, max_rows);
 
-  std::cout << "[\n";
   for (size_t r = 0; r < nrows; ++r) {
     size_t actual = row_indices ? (*row_indices)[r] : r;
     auto row = reader.row(actual);
 
+    // The separator goes before each row so no lookahead is needed
+    if (written++ > 0)
+      std::cout << ",\n";
     std::cout << "  {";
     for (size_t i = 0; i < cols.size(); ++i) {
       size_t ac = cols[i];
@@ -356,9 +411,22 @@ void render_json(const CsvReader &reader,
       }
     }
     std::cout << "}";
-    if (r + 1 < nrows)
-      std::cout << ",";
-    std::cout << "\n";
   }
+}
+
+void render_json_end(size_t written) {
+  if (written > 0)
+    std::cout << "\n";
   std::cout << "]\n";
 }
+
+void render_json(const CsvReader &reader,
+                 const std::vector<ColumnSchema> &schema,
+                 const std::vector<size_t> *row_indices,
+                 const std::vector<size_t> *col_indices, size_t max_rows) {
+  size_t written = 0;
+  render_json_begin();
+  render_json_rows(reader, schema, row_indices, col_indices, max_rows,
+                   written);
+  render_json_end(written);
+}
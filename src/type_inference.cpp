@@ -1,8 +1,20 @@
 #include "include/type_inference.hpp"
 #include "include/csv_reader.hpp"
+#include "include/parallel.hpp"
 #include <algorithm>
-#include <set>
+#include <bit>
+#include <cstring>
+#include <limits>
 #include <string>
+#include <unordered_set>
+
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 std::string_view type_name(ColumnType t) {
   switch (t) {
@@ -24,180 +36,547 @@ std::string_view type_name(ColumnType t) {
   return "text";
 }
 
-static bool is_int64(std::string_view s) {
-  if (s.empty())
-    return false;
-  size_t i = 0;
-  if (s[0] == '-' || s[0] == '+')
-    ++i;
-  if (i == s.size())
+static bool is_bool(std::string_view s) {
+  if (s.size() < 1 || s.size() > 5)
     return false;
-  for (; i < s.size(); ++i) {
-    if (s[i] < '0' || s[i] > '9')
-      return false;
+  char buf[5];
+  for (size_t i = 0; i < s.size(); ++i)
+    buf[i] = static_cast<char>(s[i] >= 'A' && s[i] <= 'Z' ? s[i] + 32 : s[i]);
+  std::string_view lower(buf, s.size());
+  return lower == "true" || lower == "false" || lower == "yes" ||
+         lower == "no" || lower == "1" || lower == "0";
+}
+
+// --- Single-pass classification ---
+
+// Character classes, one bit each; every byte is in exactly one. Every
+// class is a set of high nibbles times a set of low nibbles, so a byte's
+// class is lo[c & 15] & hi[c >> 4] and sixteen bytes are looked up with two
+// table shuffles.
+enum : uint8_t {
+  kDigit = 1,
+  kDot = 2,
+  kSign = 4,
+  kComma = 8,
+  kDollar = 16,
+  kExp = 32,
+  kOther = 64,
+};
+constexpr size_t kClassCount = 7;
+
+struct ClassTables {
+  alignas(16) uint8_t lo[16];
+  alignas(16) uint8_t hi[16];
+  uint8_t byte[256];
+};
+
+static constexpr ClassTables make_class_tables() {
+  ClassTables t{};
+  auto add = [&t](unsigned char c, uint8_t cls) {
+    t.lo[c & 15] |= cls;
+    t.hi[c >> 4] |= cls;
+  };
+  for (unsigned char c = '0'; c <= '9'; ++c)
+    add(c, kDigit);
+  add('.', kDot);
+  add('+', kSign);
+  add('-', kSign);
+  add(',', kComma);
+  add('$', kDollar);
+  add('e', kExp);
+  add('E', kExp);
+  for (int c = 0; c < 256; ++c) {
+    uint8_t cls = t.lo[c & 15] & t.hi[c >> 4];
+    t.byte[c] = cls ? cls : static_cast<uint8_t>(kOther);
   }
-  return true;
+  return t;
 }
 
-static bool is_float64(std::string_view s) {
-  if (s.empty())
-    return false;
-  size_t i = 0;
-  if (s[0] == '-' || s[0] == '+')
-    ++i;
-  if (i == s.size())
-    return false;
-  bool has_dot = false;
-  bool has_digit = false;
-  for (; i < s.size(); ++i) {
-    if (s[i] == '.') {
-      if (has_dot)
-        return false;
-      has_dot = true;
-    } else if (s[i] >= '0' && s[i] <= '9') {
-      has_digit = true;
-    } else if (s[i] == 'e' || s[i] == 'E') {
-      if (!has_digit)
-        return false;
-      ++i;
-      if (i < s.size() && (s[i] == '+' || s[i] == '-'))
-        ++i;
-      if (i == s.size())
-        return false;
-      for (; i < s.size(); ++i) {
-        if (s[i] < '0' || s[i] > '9')
-          return false;
-      }
-      return true;
-    } else {
-      return false;
-    }
+static constexpr ClassTables kClasses = make_class_tables();
+
+// One bit per byte of a 64-byte block for each class, by class bit index
+struct ClassBlock {
+  uint64_t mask[kClassCount];
+};
+
+#ifdef __ARM_NEON
+static inline uint64_t neon_movemask(const uint8x16_t m[4]) {
+  const uint8x16_t bits = {0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80,
+                           0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80};
+  uint8x16_t s0 = vpaddq_u8(vandq_u8(m[0], bits), vandq_u8(m[1], bits));
+  uint8x16_t s1 = vpaddq_u8(vandq_u8(m[2], bits), vandq_u8(m[3], bits));
+  s0 = vpaddq_u8(s0, s1);
+  s0 = vpaddq_u8(s0, s0);
+  return vgetq_lane_u64(vreinterpretq_u64_u8(s0), 0);
+}
+#endif
+
+// Classifies the first chunks 16-byte pieces of the block at p
+static ClassBlock classify64(const char *p, int chunks) {
+  ClassBlock b{};
+#ifdef __ARM_NEON
+  const uint8x16_t lo = vld1q_u8(kClasses.lo);
+  const uint8x16_t hi = vld1q_u8(kClasses.hi);
+  const uint8x16_t nibble = vdupq_n_u8(0x0f);
+  uint8x16_t c[4] = {};
+  for (int k = 0; k < chunks; ++k) {
+    uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t *>(p + 16 * k));
+    c[k] = vandq_u8(vqtbl1q_u8(lo, vandq_u8(v, nibble)),
+                    vqtbl1q_u8(hi, vshrq_n_u8(v, 4)));
+  }
+  for (size_t cls = 0; cls + 1 < kClassCount; ++cls) {
+    uint8x16_t bit = vdupq_n_u8(static_cast<uint8_t>(1u << cls));
+    uint8x16_t m[4];
+    for (int k = 0; k < 4; ++k)
+      m[k] = vceqq_u8(c[k], bit);
+    b.mask[cls] = neon_movemask(m);
+  }
+#elif defined(__SSSE3__)
+  const __m128i lo =
+      _mm_load_si128(reinterpret_cast<const __m128i *>(kClasses.lo));
+  const __m128i hi =
+      _mm_load_si128(reinterpret_cast<const __m128i *>(kClasses.hi));
+  const __m128i nibble = _mm_set1_epi8(0x0f);
+  __m128i c[4];
+  for (int k = 0; k < chunks; ++k) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 16 * k));
+    c[k] = _mm_and_si128(
+        _mm_shuffle_epi8(lo, _mm_and_si128(v, nibble)),
+        _mm_shuffle_epi8(hi, _mm_and_si128(_mm_srli_epi16(v, 4), nibble)));
+  }
+  for (size_t cls = 0; cls + 1 < kClassCount; ++cls) {
+    __m128i bit = _mm_set1_epi8(static_cast<char>(1u << cls));
+    for (int k = 0; k < chunks; ++k)
+      b.mask[cls] |= static_cast<uint64_t>(static_cast<uint16_t>(
+                         _mm_movemask_epi8(_mm_cmpeq_epi8(c[k], bit))))
+                     << (16 * k);
+  }
+#elif defined(__SSE2__)
+  // No byte shuffle: each class is one or two compares instead
+  for (int k = 0; k < chunks; ++k) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 16 * k));
+    auto eq = [&](char ch) { return _mm_cmpeq_epi8(v, _mm_set1_epi8(ch)); };
+    __m128i d = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+    __m128i m[kClassCount - 1] = {
+        _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(9)), d),
+        eq('.'),
+        _mm_or_si128(eq('+'), eq('-')),
+        eq(','),
+        eq('$'),
+        _mm_or_si128(eq('e'), eq('E')),
+    };
+    for (size_t cls = 0; cls + 1 < kClassCount; ++cls)
+      b.mask[cls] |= static_cast<uint64_t>(
+                         static_cast<uint16_t>(_mm_movemask_epi8(m[cls])))
+                     << (16 * k);
   }
-  return has_digit && has_dot;
+#else
+  for (int i = 0; i < 16 * chunks; ++i) {
+    uint8_t cls = kClasses.byte[static_cast<unsigned char>(p[i])];
+    b.mask[std::countr_zero(cls)] |= uint64_t{1} << i;
+  }
+  return b;
+#endif
+  // Every byte is in one class, so the rest are kOther
+  uint64_t known = 0;
+  for (size_t cls = 0; cls + 1 < kClassCount; ++cls)
+    known |= b.mask[cls];
+  b.mask[kClassCount - 1] = ~known;
+  return b;
 }
 
-static bool is_date(std::string_view s) {
-  if (s.size() < 8 || s.size() > 10)
-    return false;
-  if (s.size() == 10 && (s[4] == '-' || s[4] == '/') &&
-      (s[7] == '-' || s[7] == '/')) {
-    for (int i : {0, 1, 2, 3, 5, 6, 8, 9}) {
-      if (s[i] < '0' || s[i] > '9')
-        return false;
-    }
-    return true;
+// Bits [from, to) of a word, 0 <= from <= to <= 64
+static uint64_t bit_range(size_t from, size_t to) {
+  uint64_t below_to = to == 64 ? ~uint64_t{0} : (uint64_t{1} << to) - 1;
+  return below_to & ~((uint64_t{1} << from) - 1);
+}
+
+static uint64_t union_of(const uint64_t (&mask)[kClassCount], uint8_t classes) {
+  uint64_t bits = 0;
+  for (size_t cls = 0; cls < kClassCount; ++cls)
+    if (classes & (1u << cls))
+      bits |= mask[cls];
+  return bits;
+}
+
+// Class masks of one value of at most 64 bytes, bit i for byte i
+struct ValueMasks {
+  uint64_t mask[kClassCount];
+
+  size_t count(uint8_t classes, size_t lo, size_t hi) const {
+    return static_cast<size_t>(
+        std::popcount(union_of(mask, classes) & bit_range(lo, hi)));
+  }
+  // First byte in [lo, hi) in any of classes, or hi
+  size_t first(uint8_t classes, size_t lo, size_t hi) const {
+    uint64_t bits = union_of(mask, classes) & bit_range(lo, hi);
+    return bits ? static_cast<size_t>(std::countr_zero(bits)) : hi;
   }
-  if (s.size() == 10 && (s[2] == '/' || s[2] == '-') &&
-      (s[5] == '/' || s[5] == '-')) {
-    for (int i : {0, 1, 3, 4, 6, 7, 8, 9}) {
-      if (s[i] < '0' || s[i] > '9')
-        return false;
+  bool at(uint8_t classes, size_t pos) const {
+    return (union_of(mask, classes) >> pos) & 1;
+  }
+};
+
+// Class masks over the bytes one row's values span, built in one pass;
+// a value's types then come from counts and positions in the masks.
+class RowClasses {
+  const char *base_ = nullptr;
+  std::vector<ClassBlock> blocks_;
+
+  // The masks of a longer value, positions relative to its first byte
+  struct Span {
+    const RowClasses &row;
+    size_t base;
+
+    size_t count(uint8_t classes, size_t lo, size_t hi) const {
+      size_t n = 0;
+      for (lo += base, hi += base; lo < hi; lo = (lo / 64 + 1) * 64)
+        n += static_cast<size_t>(std::popcount(row.word(classes, lo, hi)));
+      return n;
+    }
+    size_t first(uint8_t classes, size_t lo, size_t hi) const {
+      for (size_t p = lo + base; p < hi + base; p = (p / 64 + 1) * 64)
+        if (uint64_t bits = row.word(classes, p, hi + base))
+          return p / 64 * 64 + static_cast<size_t>(std::countr_zero(bits)) -
+                 base;
+      return hi;
+    }
+    bool at(uint8_t classes, size_t pos) const {
+      return row.word(classes, pos + base, pos + base + 1) != 0;
     }
-    return true;
+  };
+
+  // Bits in any of classes of the word holding lo, limited to [lo, hi)
+  uint64_t word(uint8_t classes, size_t lo, size_t hi) const {
+    size_t w = lo / 64;
+    return union_of(blocks_[w].mask, classes) &
+           bit_range(lo - w * 64, std::min(hi - w * 64, size_t{64}));
   }
-  return false;
-}
 
-static bool is_currency(std::string_view s) {
-  if (s.size() < 2)
-    return false;
-  size_t i = 0;
-  if (s[0] == '$' || s[0] == '\xc2') {
-    i = 1;
-    if (i < s.size() && (s[i] == '\xa3' || s[i] == '\xa5'))
-      ++i;
+public:
+  // Classifies from the first to the end of the last value of vals whose
+  // want is nonzero; values are views into one row, in order.
+  void build(const std::vector<std::string_view> &vals, const uint8_t *want) {
+    const char *lo = nullptr, *hi = nullptr;
+    for (size_t i = 0; i < vals.size(); ++i) {
+      if (!want[i] || vals[i].empty())
+        continue;
+      if (!lo)
+        lo = vals[i].data();
+      hi = vals[i].data() + vals[i].size();
+    }
+    base_ = lo;
+    size_t n = lo ? static_cast<size_t>(hi - lo) : 0;
+    blocks_.resize((n + 63) / 64);
+    for (size_t w = 0; w < blocks_.size(); ++w) {
+      if (n - w * 64 >= 64) {
+        blocks_[w] = classify64(lo + w * 64, 4);
+      } else {
+        char buf[64] = {};
+        std::memcpy(buf, lo + w * 64, n - w * 64);
+        blocks_[w] = classify64(buf, static_cast<int>(n - w * 64 + 15) / 16);
+      }
+    }
   }
-  if (i == s.size())
-    return false;
-  if (s[i] == '-' || s[i] == '+')
-    ++i;
-  bool has_digit = false;
-  bool has_dot = false;
-  for (; i < s.size(); ++i) {
-    if (s[i] >= '0' && s[i] <= '9') {
-      has_digit = true;
-    } else if (s[i] == ',') {
-    } else if (s[i] == '.') {
-      if (has_dot)
-        return false;
-      has_dot = true;
-    } else {
-      return false;
+
+  // Every type a non-empty value from build's vals satisfies
+  uint8_t types(std::string_view v) const;
+};
+
+// Candidate types, one bit each
+enum : uint8_t {
+  kIsBool = 1,
+  kIsCurrency = 2,
+  kIsDate = 4,
+  kIsInt = 8,
+  kIsFloat = 16,
+  kAnyType = 31,
+};
+
+static bool is_date_separator(char c) { return c == '-' || c == '/'; }
+
+// Every type v satisfies, from m's counts and positions of its byte
+// classes; integers also count as floats, so a decimal column may hold
+// both. Numbers: [sign] digits with at most one point, then for a float
+// an optional e [sign] digits. Dates: 8 digits around two separators at 4
+// and 7 or at 2 and 5. Currency: $ and at most one sign in either order,
+// then digits with thousands separators before the point and at most two
+// after it, as parse_currency_cents reads them.
+template <typename Masks>
+static uint8_t value_types(const Masks &m, std::string_view v) {
+  size_t n = v.size();
+  size_t digits = m.count(kDigit, 0, n);
+  uint8_t types = 0;
+  if (n <= 5 && (digits == 0 || n == 1) && is_bool(v))
+    types |= kIsBool;
+  if (digits == 0)
+    return types;
+
+  size_t signs = m.count(kSign, 0, n);
+  size_t dots = m.count(kDot, 0, n);
+  size_t lead_sign = m.at(kSign, 0);
+  if (m.count(kComma | kDollar | kOther, 0, n) == 0 && dots <= 1) {
+    size_t e = m.first(kExp, 0, n);
+    if (e == n) {
+      if (signs == lead_sign)
+        types |= dots == 0 ? kIsInt | kIsFloat : kIsFloat;
+    } else if (m.count(kExp | kDot, e + 1, n) == 0 &&
+               m.count(kDigit, 0, e) > 0 && m.count(kDigit, e + 1, n) > 0) {
+      size_t exp_sign = m.at(kSign, e + 1);
+      if (signs == lead_sign + exp_sign)
+        types |= kIsFloat;
     }
   }
-  return has_digit && s[0] == '$';
+
+  if (n == 10 && digits == 8 &&
+      ((is_date_separator(v[4]) && is_date_separator(v[7])) ||
+       (is_date_separator(v[2]) && is_date_separator(v[5]))))
+    types |= kIsDate;
+
+  if (digits <= 17 && dots <= 1 && m.count(kDollar, 0, n) == 1 &&
+      m.count(kExp | kOther, 0, n) == 0) {
+    size_t dollar = m.first(kDollar, 0, n);
+    bool prefix = dollar == 0 ? signs == m.at(kSign, 1)
+                              : dollar == 1 && lead_sign && signs == 1;
+    size_t point = m.first(kDot, 0, n);
+    if (prefix && m.count(kComma, point, n) == 0 &&
+        m.count(kDigit, point, n) <= 2)
+      types |= kIsCurrency;
+  }
+  return types;
 }
 
-static bool is_bool(std::string_view s) {
-  if (s.size() < 1 || s.size() > 5)
-    return false;
-  std::string lower;
-  lower.reserve(s.size());
-  for (char c : s)
-    lower += static_cast<char>(c >= 'A' && c <= 'Z' ? c + 32 : c);
-  return lower == "true" || lower == "false" || lower == "yes" ||
-         lower == "no" || lower == "1" || lower == "0";
+uint8_t RowClasses::types(std::string_view v) const {
+  size_t lo = static_cast<size_t>(v.data() - base_);
+  if (v.size() > 64)
+    return value_types(Span{*this, lo}, v);
+  // Shift the value's bits down to bit 0, from one word or two
+  ValueMasks m;
+  size_t w = lo / 64, shift = lo % 64;
+  bool split = shift + v.size() > 64;
+  uint64_t keep = bit_range(0, v.size());
+  for (size_t cls = 0; cls < kClassCount; ++cls) {
+    uint64_t bits = blocks_[w].mask[cls] >> shift;
+    if (split)
+      bits |= blocks_[w + 1].mask[cls] << (64 - shift);
+    m.mask[cls] = bits & keep;
+  }
+  return value_types(m, v);
+}
+
+// The most specific type shared by every value; distinct is the number of
+// distinct values, or SIZE_MAX when unknown
+static ColumnType resolve_type(uint8_t types, size_t values, size_t distinct) {
+  if (values == 0)
+    return ColumnType::Text;
+  if (types & kIsBool)
+    return ColumnType::Bool;
+  if (types & kIsCurrency)
+    return ColumnType::Currency;
+  if (types & kIsDate)
+    return ColumnType::Date;
+  if (types & kIsInt)
+    return ColumnType::Int64;
+  if (types & kIsFloat)
+    return ColumnType::Float64;
+  if (distinct < std::max(static_cast<size_t>(2), values / 10))
+    return ColumnType::Enum;
+  return ColumnType::Text;
 }
 
 std::vector<ColumnSchema> infer_schema(const CsvReader &reader,
-                                       size_t sample_size) {
+                                       size_t budget) {
   std::vector<ColumnSchema> schema;
+  schema.reserve(reader.column_count());
   size_t ncols = reader.column_count();
-  size_t nrows = std::min(reader.row_count(), sample_size);
 
-  for (size_t col = 0; col < ncols; ++col) {
-    std::string col_name = unquote(reader.headers()[col]);
+  // The first parsed rows, then rows from byte strata across the whole
+  // input, skipping any already taken; each row is classified once
+  std::vector<uint8_t> types(ncols, kAnyType);
+  std::vector<size_t> values(ncols);
+  std::vector<std::unordered_set<std::string_view>> distinct(ncols);
+  std::vector<std::string_view> vals(ncols);
+  RowClasses classes;
+  auto take = [&](const RowView &row) {
+    for (size_t col = 0; col < ncols; ++col)
+      vals[col] = col < row.size() ? strip_quotes(row[col]) : "";
+    classes.build(vals, types.data());
+    for (size_t col = 0; col < ncols; ++col) {
+      if (vals[col].empty())
+        continue;
+      ++values[col];
+      if (types[col])
+        types[col] &= classes.types(vals[col]);
+      distinct[col].insert(vals[col]);
+    }
+  };
+  size_t head = std::min({reader.row_count(), budget, kInferenceHeadRows});
+  std::unordered_set<const char *> seen;
+  for (size_t r = 0; r < head; ++r) {
+    auto row = reader.row(r);
+    seen.insert(row[0].data());
+    take(row);
+  }
+  for (auto span : reader.stratified_rows(budget - head))
+    if (!seen.count(span.data()))
+      take(RowView(span.data(), span.size(), reader.delimiter(), ncols));
 
-    if (nrows == 0) {
-      schema.push_back({std::move(col_name), ColumnType::Text});
-      continue;
+  for (size_t col = 0; col < ncols; ++col)
+    schema.push_back({unquote(reader.headers()[col]),
+                      resolve_type(types[col], values[col],
+                                   distinct[col].size())});
+
+  return schema;
+}
+
+void SchemaTally::add(const CsvReader &reader, size_t threads) {
+  size_t ncols = reader.column_count();
+  if (columns_.empty()) {
+    columns_.resize(ncols);
+    for (size_t col = 0; col < ncols; ++col) {
+      columns_[col].name = unquote(reader.headers()[col]);
+      columns_[col].types = kAnyType;
     }
+  }
+
+  // Each thread classifies a slice of rows. Distinct values only matter
+  // once no type fits, so a column starts collecting them at the first
+  // value that leaves it untyped; the rows before that are revisited only
+  // if the column ends up untyped overall.
+  struct Local {
+    uint8_t types;
+    size_t values = 0;
+    size_t tracked_from; // first row whose values are in distinct
+    bool overflow = false;
+    std::unordered_set<std::string_view> distinct;
+  };
+  auto insert = [](Local &l, std::string_view v) {
+    if (l.overflow)
+      return;
+    l.distinct.insert(v);
+    if (l.distinct.size() > kEnumMaxValues) {
+      l.overflow = true;
+      l.distinct = {};
+    }
+  };
 
-    std::vector<std::string_view> values;
-    std::set<std::string> unique_values;
-    for (size_t r = 0; r < nrows; ++r) {
+  size_t rows = reader.row_count();
+  size_t n = threads_for(rows, threads);
+  auto first_row = [&](size_t t) { return part_begin(rows, n, t); };
+  std::vector<std::vector<Local>> locals(n, std::vector<Local>(ncols));
+
+  run_parallel(n, [&](size_t t) {
+    size_t begin = first_row(t), end = first_row(t + 1);
+    auto &cols = locals[t];
+    // Only columns that still have a type are classified
+    std::vector<uint8_t> want(ncols);
+    for (size_t col = 0; col < ncols; ++col) {
+      cols[col].types = columns_[col].types;
+      cols[col].tracked_from = cols[col].types ? end : begin;
+      want[col] = cols[col].types;
+    }
+    std::vector<std::string_view> vals(ncols);
+    RowClasses classes;
+    for (size_t r = begin; r < end; ++r) {
       auto row = reader.row(r);
-      if (col < row.size()) {
-        std::string val = unquote(row[col]);
-        if (!val.empty()) {
-          values.push_back(row[col]);
-          unique_values.insert(val);
+      for (size_t col = 0; col < ncols; ++col)
+        vals[col] = strip_quotes(row[col]);
+      classes.build(vals, want.data());
+      for (size_t col = 0; col < ncols; ++col) {
+        auto v = vals[col];
+        if (v.empty())
+          continue;
+        Local &l = cols[col];
+        ++l.values;
+        if (l.types) {
+          l.types &= classes.types(v);
+          if (l.types)
+            continue;
+          want[col] = 0;
+          l.tracked_from = r;
         }
+        insert(l, v);
       }
     }
+  });
 
-    if (values.empty()) {
-      schema.push_back({std::move(col_name), ColumnType::Text});
-      continue;
+  std::vector<uint8_t> types(ncols);
+  std::vector<size_t> backfill;
+  for (size_t col = 0; col < ncols; ++col) {
+    types[col] = columns_[col].types;
+    bool untracked = false;
+    for (size_t t = 0; t < n; ++t) {
+      types[col] &= locals[t][col].types;
+      untracked |= locals[t][col].tracked_from > first_row(t);
     }
+    const Column &c = columns_[col];
+    if (types[col] == 0 && untracked && c.complete && !c.overflow)
+      backfill.push_back(col);
+  }
 
-    auto all_match = [&](auto pred) {
-      for (auto &v : values) {
-        std::string uv = unquote(v);
-        if (!pred(std::string_view(uv)))
-          return false;
+  if (!backfill.empty()) {
+    run_parallel(n, [&](size_t t) {
+      auto &cols = locals[t];
+      for (size_t r = first_row(t); r < first_row(t + 1); ++r) {
+        auto row = reader.row(r);
+        for (size_t col : backfill) {
+          if (r >= cols[col].tracked_from)
+            continue;
+          auto v = strip_quotes(row[col]);
+          if (!v.empty())
+            insert(cols[col], v);
+        }
       }
-      return true;
-    };
+    });
+  }
 
-    ColumnType detected = ColumnType::Text;
-    if (all_match(is_bool)) {
-      detected = ColumnType::Bool;
-    } else if (all_match(is_currency)) {
-      detected = ColumnType::Currency;
-    } else if (all_match(is_date)) {
-      detected = ColumnType::Date;
-    } else if (all_match(is_int64)) {
-      detected = ColumnType::Int64;
-    } else if (all_match(is_float64)) {
-      detected = ColumnType::Float64;
-    } else if (unique_values.size() <
-               std::max(static_cast<size_t>(2), values.size() / 10)) {
-      detected = ColumnType::Enum;
+  for (size_t col = 0; col < ncols; ++col) {
+    Column &c = columns_[col];
+    size_t values = 0;
+    for (size_t t = 0; t < n; ++t)
+      values += locals[t][col].values;
+    c.types = types[col];
+    c.values += values;
+    if (c.types != 0) {
+      // Still typed: this reader's values were never collected
+      if (values > 0)
+        c.complete = false;
+      continue;
     }
-
-    schema.push_back({std::move(col_name), detected});
+    for (size_t t = 0; t < n && c.complete && !c.overflow; ++t) {
+      const Local &l = locals[t][col];
+      if (l.overflow) {
+        c.overflow = true;
+        break;
+      }
+      for (auto v : l.distinct) {
+        c.distinct.emplace(v);
+        if (c.distinct.size() > kEnumMaxValues) {
+          c.overflow = true;
+          break;
+        }
+      }
+    }
+    if (c.overflow)
+      c.distinct = {};
   }
+}
 
+std::vector<ColumnSchema> SchemaTally::schema() const {
+  std::vector<ColumnSchema> schema;
+  schema.reserve(columns_.size());
+  for (const Column &c : columns_) {
+    size_t distinct = c.complete && !c.overflow
+                          ? c.distinct.size()
+                          : std::numeric_limits<size_t>::max();
+    schema.push_back({c.name, resolve_type(c.types, c.values, distinct)});
+  }
   return schema;
 }
+
+std::vector<ColumnSchema> infer_schema_exact(const CsvReader &reader,
+                                             size_t threads) {
+  SchemaTally tally;
+  tally.add(reader, threads);
+  return tally.schema();
+}
@@ -0,0 +1,84 @@
+#include <catch2/catch_test_macros.hpp>
+#include "include/column_stats.hpp"
+#include "include/csv_reader.hpp"
+#include "include/type_inference.hpp"
+#include "test_helpers.hpp"
+#include <cmath>
+
+static bool near(double a, double b) {
+  return std::abs(a - b) <= 1e-9 * std::max(1.0, std::abs(b));
+}
+
+TEST_CASE("compute_column_stats: typed ranges and moments", "[stats]") {
+  TempCsv csv("n,price,day,ok,name\n"
+              "9,$1.50,2024-02-01,yes,\"b \"\"q\"\"\"\n"
+              "10,\"$1,000\",01/15/2024,no,a\n"
+              ",$2,2023-12-31,true,\n"
+              "x,$0.25,never,maybe,c\n");
+  CsvReader reader(csv.path());
+  reader.parse(',');
+  std::vector<ColumnSchema> schema = {{"n", ColumnType::Int64},
+                                      {"price", ColumnType::Currency},
+                                      {"day", ColumnType::Date},
+                                      {"ok", ColumnType::Bool},
+                                      {"name", ColumnType::Text}};
+  auto stats = compute_column_stats(reader, schema);
+
+  // Numbers order by value, not text; the cell that does not parse is
+  // counted but not ranged
+  REQUIRE(stats[0].nulls == 1);
+  REQUIRE(stats[0].min == "9");
+  REQUIRE(stats[0].max == "10");
+  REQUIRE(stats[0].numbers == 2);
+  REQUIRE(stats[0].mean == 9.5);
+  REQUIRE(near(stats[0].stddev, std::sqrt(0.5)));
+  REQUIRE(stats[0].distinct == 3);
+
+  REQUIRE(stats[1].min == "$0.25");
+  REQUIRE(stats[1].max == "$1,000");
+  REQUIRE(near(stats[1].mean, (1.5 + 1000 + 2 + 0.25) / 4));
+
+  REQUIRE(stats[2].min == "2023-12-31");
+  REQUIRE(stats[2].max == "2024-02-01");
+  REQUIRE(stats[2].numbers == 0);
+
+  REQUIRE(stats[3].min == "no");
+  REQUIRE(stats[3].max == "yes");
+
+  REQUIRE(stats[4].nulls == 1);
+  REQUIRE(stats[4].min == "a");
+  REQUIRE(stats[4].max == "c");
+  REQUIRE(stats[4].max_width == 5); // b "q"
+}
+
+TEST_CASE("compute_column_stats: threads and row subsets", "[stats]") {
+  std::string content = "id,grp\n";
+  for (int i = 0; i < 100000; ++i)
+    content += std::to_string(i) + "," + std::to_string(i % 7) + "\n";
+  TempCsv csv(content);
+  CsvReader reader(csv.path());
+  reader.parse_lazy(',');
+  auto schema = infer_schema(reader);
+
+  auto one = compute_column_stats(reader, schema, 1);
+  auto many = compute_column_stats(reader, schema, 8);
+  for (size_t c = 0; c < 2; ++c) {
+    REQUIRE(many[c].min == one[c].min);
+    REQUIRE(many[c].max == one[c].max);
+    REQUIRE(many[c].distinct == one[c].distinct);
+    REQUIRE(near(many[c].mean, one[c].mean));
+    REQUIRE(near(many[c].stddev, one[c].stddev));
+  }
+  REQUIRE(one[0].max == "99999");
+  REQUIRE(near(one[0].mean, 49999.5));
+  REQUIRE(one[1].distinct == 7);
+  // HyperLogLog: within a few standard errors
+  REQUIRE(one[0].distinct > 95000);
+  REQUIRE(one[0].distinct < 105000);
+
+  std::vector<size_t> rows = {5, 70000, 12};
+  auto subset = compute_column_stats(reader, schema, 4, &rows);
+  REQUIRE(subset[0].min == "5");
+  REQUIRE(subset[0].max == "70000");
+  REQUIRE(subset[0].numbers == 3);
+}
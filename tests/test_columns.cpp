@@ -0,0 +1,249 @@
+#include <catch2/catch_test_macros.hpp>
+#include "include/columns.hpp"
+#include "include/csv_reader.hpp"
+#include "include/filter.hpp"
+#include "include/type_inference.hpp"
+#include "test_helpers.hpp"
+#include <numeric>
+
+TEST_CASE("value parsers", "[columns]") {
+  int64_t i = 0;
+  REQUIRE((parse_int64("+42", i) && i == 42));
+  REQUIRE((parse_int64("-7", i) && i == -7));
+  REQUIRE_FALSE(parse_int64("+-7", i));
+  REQUIRE_FALSE(parse_int64("4 2", i));
+  REQUIRE_FALSE(parse_int64("99999999999999999999", i));
+
+  double d = 0;
+  REQUIRE((parse_float64("+.5", d) && d == 0.5));
+  REQUIRE((parse_float64("1e3", d) && d == 1000.0));
+  REQUIRE_FALSE(parse_float64("1.5x", d));
+
+  int64_t cents = 0;
+  REQUIRE((parse_currency_cents("$1,234.5", cents) && cents == 123450));
+  REQUIRE((parse_currency_cents("$-12", cents) && cents == -1200));
+  REQUIRE((parse_currency_cents("72000.50", cents) && cents == 7200050));
+  REQUIRE_FALSE(parse_currency_cents("$1.005", cents));
+  REQUIRE_FALSE(parse_currency_cents("$", cents));
+
+  int64_t days = 0;
+  REQUIRE((parse_date_days("1970-01-02", days) && days == 1));
+  REQUIRE((parse_date_days("2000-03-01", days) && days == 11017));
+  int64_t us = 0, eu = 0;
+  REQUIRE((parse_date_days("03/01/2000", us) && us == days));
+  REQUIRE((parse_date_days("25/12/2020", eu) &&
+           parse_date_days("2020-12-25", days) && eu == days));
+  REQUIRE_FALSE(parse_date_days("2023-02-29", days));
+  REQUIRE(parse_date_days("2024-02-29", days));
+
+  bool b = false;
+  REQUIRE((parse_bool("YES", b) && b));
+  REQUIRE((parse_bool("0", b) && !b));
+  REQUIRE_FALSE(parse_bool("maybe", b));
+}
+
+TEST_CASE("ColumnStore: decodes each type with validity", "[columns]") {
+  TempCsv csv("n,x,price,day,ok,tier,note\n"
+              "1,1.5,$2.00,2024-01-02,true,gold,a\n"
+              "\"2\",,\"$1,000\",2024-01-01,no,\"silver\",b\n"
+              "n/a,2,$3.50,soon,yes,,c\n");
+  CsvReader reader(csv.path());
+  reader.parse(',');
+  std::vector<ColumnSchema> schema = {
+      {"n", ColumnType::Int64},    {"x", ColumnType::Float64},
+      {"price", ColumnType::Currency}, {"day", ColumnType::Date},
+      {"ok", ColumnType::Bool},    {"tier", ColumnType::Enum},
+      {"note", ColumnType::Text}};
+  ColumnStore store(reader, schema, {0, 1, 2, 3, 4, 5, 6}, 4);
+
+  auto *n = store.column(0);
+  REQUIRE((n->is_valid(0) && n->is_valid(1) && !n->is_valid(2)));
+  REQUIRE(n->ints[1] == 2);
+
+  auto *x = store.column(1);
+  REQUIRE((x->is_valid(0) && !x->is_valid(1) && x->is_valid(2)));
+  REQUIRE(x->number(0) == 1.5);
+
+  auto *price = store.column(2);
+  REQUIRE(price->ints[0] == 200);
+  REQUIRE(price->ints[1] == 100000);
+  REQUIRE(price->number(2) == 3.5);
+
+  auto *day = store.column(3);
+  REQUIRE(day->ints[0] == day->ints[1] + 1);
+  REQUIRE_FALSE(day->is_valid(2));
+
+  auto *ok = store.column(4);
+  REQUIRE((ok->flag(0) && !ok->flag(1) && ok->flag(2)));
+
+  auto *tier = store.column(5);
+  REQUIRE(tier->dictionary == std::vector<std::string>{"", "gold", "silver"});
+  REQUIRE(tier->codes == std::vector<uint32_t>{1, 2, 0});
+  REQUIRE_FALSE(tier->is_valid(2));
+
+  REQUIRE(store.column(6) == nullptr);
+}
+
+TEST_CASE("ColumnStore: filters and sort match the text path", "[columns]") {
+  // Enough rows for several decoding threads
+  std::string content = "id,price,day,ok,tier\n";
+  for (int i = 0; i < 36000; ++i) {
+    content += std::to_string((i * 7919) % 36000) + ",";
+    content += i % 1000 == 0 ? "free," : "$" + std::to_string(i % 500) + ".25,";
+    content += "2024-0" + std::to_string(1 + i % 9) + "-1" +
+               std::to_string(i % 10) + ",";
+    content += i % 3 ? "true," : "false,";
+    content += i % 4 == 0 ? "\"b\"\n" : i % 4 == 1 ? "a\n" : "c\n";
+  }
+  TempCsv csv(content);
+  CsvReader reader(csv.path());
+  reader.parse(',');
+  // As if sampling had missed the rows that are not prices
+  auto schema = infer_schema(reader);
+  schema[1].type = ColumnType::Currency;
+  ColumnStore store(reader, schema, {0, 1, 2, 3, 4}, 4);
+
+  for (const char *expr : {"id > 35000", "price <= 12.25", "price != 3.25",
+                           "day >= 2024-05-01", "ok == false",
+                           "tier == b", "price == free"}) {
+    std::vector<Filter> filters = {parse_filter(expr)};
+    REQUIRE(apply_filters(filters, reader, schema, false, false, &store) ==
+            apply_filters(filters, reader, schema));
+  }
+
+  for (const char *col : {"id", "price", "day", "tier"}) {
+    std::vector<size_t> text(reader.row_count()), typed;
+    std::iota(text.begin(), text.end(), size_t{0});
+    typed = text;
+    sort_indices(text, reader, schema, col, true);
+    sort_indices(typed, reader, schema, col, true, &store);
+    REQUIRE(typed == text);
+  }
+}
+
+TEST_CASE("ColumnStore: block filters match the text path at the edges",
+          "[columns]") {
+  // Not a whole number of blocks, with cells that do not decode
+  std::string content = "n,x,price\n";
+  for (int i = 0; i < 2500; ++i) {
+    content += i % 97 == 0 ? "n/a," : std::to_string(i - 1250) + ",";
+    content += i % 89 == 0 ? "," : std::to_string((i - 1250) * 0.25) + ",";
+    content += "$" + std::to_string(i % 300) + "." +
+               std::to_string(10 + i % 90) + "\n";
+  }
+  TempCsv csv(content);
+  CsvReader reader(csv.path());
+  reader.parse(',');
+  auto schema = infer_schema(reader);
+  schema[0].type = ColumnType::Int64;
+  schema[1].type = ColumnType::Float64;
+  schema[2].type = ColumnType::Currency;
+  ColumnStore store(reader, schema, {0, 1, 2});
+
+  for (const char *expr :
+       {"n > 3.5", "n >= 3.5", "n < -3.5", "n <= 4", "n == 4", "n == 4.5",
+        "n != 4", "n != 4.5", "n > 99999999999999999999", "x == 0.25",
+        "x != 0.25", "x > -1.5", "x <= 0", "price > 12.5", "price == 12.50",
+        "price < $1", "price != 5.1"}) {
+    std::vector<Filter> filters = {parse_filter(expr)};
+    INFO(expr);
+    REQUIRE(apply_filters(filters, reader, schema, false, false, &store) ==
+            apply_filters(filters, reader, schema));
+  }
+
+  std::vector<Filter> mixed = {parse_filter("n > 1000"),
+                               parse_filter("x contains 5"),
+                               parse_filter("price <= 0.5")};
+  for (bool or_logic : {false, true})
+    REQUIRE(apply_filters(mixed, reader, schema, false, or_logic, &store) ==
+            apply_filters(mixed, reader, schema, false, or_logic));
+}
+
+TEST_CASE("ColumnStore: dates and bools compare alike without a store",
+          "[columns]") {
+  // Streams filter without decoded columns, so the text path has to
+  // compare dates by day and bools by value too
+  std::string content = "d,active\n06/01/2024,yes\n12/31/2023,no\n"
+                        "2024-07-01,true\n";
+  for (int i = 0; i < 3000; ++i) {
+    content += i % 101 == 0 ? "soon," : i % 2 ? "2024-0" : "0";
+    if (i % 101 != 0)
+      content += std::to_string(1 + i % 9) + (i % 2 ? "-15," : "/15/2024,");
+    content += i % 103 == 0 ? "maybe\n" : i % 3 ? "Yes\n" : "0\n";
+  }
+  TempCsv csv(content);
+  CsvReader reader(csv.path());
+  reader.parse(',');
+  auto schema = infer_schema(reader);
+  schema[0].type = ColumnType::Date;
+  schema[1].type = ColumnType::Bool;
+  ColumnStore store(reader, schema, {0, 1});
+
+  std::vector<Filter> later = {parse_filter("d > 01/15/2024")};
+  REQUIRE(apply_filters(later, reader, schema).front() == 0);
+  std::vector<Filter> on = {parse_filter("active == true")};
+  auto hits = apply_filters(on, reader, schema);
+  REQUIRE(std::vector<size_t>(hits.begin(), hits.begin() + 2) ==
+          std::vector<size_t>{0, 2});
+
+  for (bool ci : {false, true}) {
+    for (const char *expr :
+         {"d > 01/15/2024", "d <= 2024-05-15", "d == 2024-06-01",
+          "d != 06/01/2024", "d in 2024-07-01, 12/31/2023", "d < soon",
+          "d contains 2024", "active == true", "active != YES",
+          "active == 1", "active in no, maybe", "active == maybe",
+          "active > no"}) {
+      std::vector<Filter> filters = {parse_filter(expr)};
+      INFO(expr << (ci ? " -i" : ""));
+      REQUIRE(apply_filters(filters, reader, schema, ci, false, &store) ==
+              apply_filters(filters, reader, schema, ci));
+    }
+  }
+}
+
+TEST_CASE("ColumnStore: enum filters look up codes", "[columns]") {
+  CsvReader reader(fixture_path("basic.csv").c_str());
+  reader.parse(',');
+  // Too few rows to infer one, but department is an enum
+  auto schema = infer_schema(reader);
+  schema[5].type = ColumnType::Enum;
+  ColumnStore store(reader, schema, {5});
+
+  for (bool ci : {false, true}) {
+    for (const char *expr :
+         {"department == Sales", "department != engineering",
+          "department in Sales, Management, nope",
+          "department contains ING", "department > M"}) {
+      std::vector<Filter> filters = {parse_filter(expr)};
+      REQUIRE(apply_filters(filters, reader, schema, ci, false, &store) ==
+              apply_filters(filters, reader, schema, ci));
+    }
+  }
+}
+
+TEST_CASE("ColumnStore: expressions fold enum constants", "[columns]") {
+  CsvReader reader(fixture_path("basic.csv").c_str());
+  reader.parse(',');
+  auto schema = infer_schema(reader);
+  schema[5].type = ColumnType::Enum;
+  ColumnStore store(reader, schema, {1, 5});
+
+  // department == nope matches no code and department != nope every one
+  for (const char *expr :
+       {"department == nope or age > 40", "department == nope and age > 1",
+        "not department == nope", "department != nope and not age >= 30",
+        "(department == Sales or department == nope) and name ends_with a",
+        "not (department in Sales, Marketing or age < 30)"}) {
+    INFO(expr);
+    auto e = parse_filter_expr(expr);
+    REQUIRE(apply_filters(e, reader, schema, false, &store) ==
+            apply_filters(e, reader, schema));
+  }
+  REQUIRE(apply_filters(parse_filter_expr("department == nope or age > 40"),
+                        reader, schema, false, &store) ==
+          std::vector<size_t>{5});
+  // Folded away or not, an unknown column is still reported
+  REQUIRE_THROWS(apply_filters(
+      parse_filter_expr("department == nope and missing == 1"), reader,
+      schema, false, &store));
+}
@@ -2,6 +2,8 @@
 #include "include/csv_reader.hpp"
 #include "include/delim.hpp"
 #include "test_helpers.hpp"
+#include <fcntl.h>
+#include <memory>
 
 TEST_CASE("CsvReader: open basic.csv", "[csv_reader]") {
   CsvReader reader(fixture_path("basic.csv").c_str());
@@ -121,3 +123,345 @@ TEST_CASE("CsvReader: nonexistent file throws", "[csv_reader]") {
   REQUIRE_THROWS_AS(CsvReader("nonexistent_file_xyz.csv"),
                     std::runtime_error);
 }
+
+static std::string make_quoted_csv(size_t rows) {
+  std::string content = "id,name,notes,amount\n";
+  for (size_t i = 0; i < rows; ++i) {
+    content += std::to_string(i) + ",";
+    if (i % 3 == 0)
+      content += "\"Last, First " + std::to_string(i) + "\",";
+    else
+      content += "plain" + std::to_string(i) + ",";
+    if (i % 7 == 0)
+      content += "\"multi\nline \"\"quoted\"\" note\",";
+    else if (i % 11 == 0)
+      content += ",";
+    else
+      content += "note,";
+    content += std::to_string(i * 3) + ((i % 5 == 0) ? "\r\n" : "\n");
+    if (i % 13 == 0)
+      content += "\n";
+  }
+  return content;
+}
+
+TEST_CASE("CsvReader: parallel parse matches serial parse", "[csv_reader]") {
+  // Large enough that four 1MB-minimum ranges are actually used
+  TempCsv csv(make_quoted_csv(120000));
+
+  CsvReader serial(csv.path());
+  serial.parse(',');
+  CsvReader parallel(csv.path());
+  parallel.parse(',', 4);
+
+  REQUIRE(serial.row_count() == 120000);
+  REQUIRE(parallel.row_count() == serial.row_count());
+  REQUIRE(parallel.total_rows() == serial.total_rows());
+  size_t mismatches = 0;
+  for (size_t r = 0; r < serial.row_count(); ++r) {
+    auto a = serial.row(r);
+    auto b = parallel.row(r);
+    for (size_t c = 0; c < serial.column_count(); ++c)
+      if (a[c] != b[c])
+        ++mismatches;
+  }
+  REQUIRE(mismatches == 0);
+}
+
+TEST_CASE("CsvReader: threaded row count matches serial count",
+          "[csv_reader]") {
+  TempCsv csv(make_quoted_csv(120000));
+
+  CsvReader serial(csv.path());
+  serial.parse_head(',', 10);
+  CsvReader threaded(csv.path());
+  threaded.parse_head(',', 10, 4);
+  REQUIRE(threaded.total_rows() == serial.total_rows());
+
+  CsvReader serial_tail(csv.path());
+  serial_tail.parse_tail(',', 10);
+  CsvReader threaded_tail(csv.path());
+  threaded_tail.parse_tail(',', 10, 4);
+  REQUIRE(threaded_tail.total_rows() == serial_tail.total_rows());
+  REQUIRE(threaded_tail.row(9)[0] == "119999");
+}
+
+TEST_CASE("CsvReader: compact index decodes unseparated and padded fields",
+          "[csv_reader]") {
+  TempCsv csv("a,b,c,d\n\"ab\"c,d\nx,,\n");
+  CsvReader reader(csv.path());
+  reader.parse(',');
+  REQUIRE(reader.row_count() == 2);
+
+  auto r0 = reader.row(0);
+  REQUIRE(r0.size() == 4);
+  REQUIRE(r0[0] == "\"ab\"");
+  REQUIRE(r0[1] == "c");
+  REQUIRE(r0[2] == "d");
+  REQUIRE(r0[3].empty());
+
+  auto r1 = reader.row(1);
+  REQUIRE(r1[0] == "x");
+  REQUIRE(r1[1].empty());
+  REQUIRE(r1[2].empty());
+  REQUIRE(r1[3].empty());
+}
+
+TEST_CASE("CsvReader: lazy parse tokenizes rows on access", "[csv_reader]") {
+  TempCsv csv(make_quoted_csv(120000));
+
+  CsvReader full(csv.path());
+  full.parse(',');
+  CsvReader lazy(csv.path());
+  lazy.parse_lazy(',', 4);
+
+  REQUIRE(lazy.row_count() == full.row_count());
+  REQUIRE(lazy.total_rows() == full.total_rows());
+  size_t mismatches = 0;
+  for (size_t r = 0; r < full.row_count(); ++r) {
+    auto a = full.row(r);
+    auto b = lazy.row(r);
+    // Walk right-to-left to exercise cursor rewinds
+    for (size_t c = full.column_count(); c-- > 0;)
+      if (a[c] != b[c])
+        ++mismatches;
+  }
+  REQUIRE(mismatches == 0);
+  REQUIRE(lazy.field(7, 2) == "\"multi\nline \"\"quoted\"\" note\"");
+}
+
+TEST_CASE("CsvReader: parse_tail matches the end of a full parse",
+          "[csv_reader]") {
+  std::string content = make_quoted_csv(500);
+  TempCsv csv(content);
+  CsvReader full(csv.path());
+  full.parse(',');
+
+  for (size_t n : {0, 1, 7, 20, 499, 500, 1000}) {
+    CsvReader tail(csv.path());
+    tail.parse_tail(',', n);
+    size_t expected = std::min(n, full.row_count());
+    REQUIRE(tail.row_count() == expected);
+    size_t offset = full.row_count() - expected;
+    for (size_t r = 0; r < expected; ++r)
+      for (size_t c = 0; c < full.column_count(); ++c)
+        REQUIRE(tail.row(r)[c] == full.row(offset + r)[c]);
+  }
+}
+
+TEST_CASE("CsvReader: parse_tail on quoted.csv", "[csv_reader]") {
+  CsvReader reader(fixture_path("quoted.csv").c_str());
+  reader.parse_tail(',', 2);
+  REQUIRE(reader.row_count() == 2);
+  REQUIRE(reader.total_rows() == 3);
+  REQUIRE(unquote(reader.row(0)[0]) == "Doe, Jane");
+  REQUIRE(unquote(reader.row(1)[0]) == "Simple");
+}
+
+TEST_CASE("CsvReader: streamed blocks match a full parse", "[csv_reader]") {
+  std::string content = make_quoted_csv(500);
+  TempCsv csv(content);
+  CsvReader full(csv.path());
+  full.parse(',');
+
+  // Blocks smaller than some rows force carried and grown partial rows
+  for (size_t block : {16, 100, 4096, 1 << 20}) {
+    int fd = open(csv.path(), O_RDONLY);
+    REQUIRE(fd >= 0);
+    CsvReader stream(fd, block);
+    size_t r = 0;
+    do {
+      stream.parse_lazy(',');
+      REQUIRE(stream.column_count() == full.column_count());
+      REQUIRE(stream.headers()[3] == "amount");
+      for (size_t i = 0; i < stream.row_count(); ++i, ++r)
+        for (size_t c = 0; c < full.column_count(); ++c)
+          REQUIRE(stream.row(i)[c] == full.row(r)[c]);
+    } while (stream.read_block());
+    close(fd);
+    REQUIRE(r == full.row_count());
+    REQUIRE(stream.bytes_read() == content.size());
+  }
+}
+
+TEST_CASE("CsvReader: stream of an empty descriptor throws",
+          "[csv_reader]") {
+  TempCsv csv("");
+  int fd = open(csv.path(), O_RDONLY);
+  REQUIRE(fd >= 0);
+  REQUIRE_THROWS_AS(CsvReader(fd, 64), std::runtime_error);
+  close(fd);
+}
+
+TEST_CASE("CsvReader: a pipe path is drained and parsed", "[csv_reader]") {
+  std::string content = make_quoted_csv(200);
+  REQUIRE(content.size() < 16384); // fits in the pipe buffer
+  int fds[2];
+  REQUIRE(pipe(fds) == 0);
+  REQUIRE(::write(fds[1], content.data(), content.size()) ==
+          static_cast<ssize_t>(content.size()));
+  close(fds[1]);
+
+  std::string path = "/dev/fd/" + std::to_string(fds[0]);
+  CsvReader piped(path.c_str());
+  close(fds[0]);
+  REQUIRE(piped.size() == content.size());
+  REQUIRE(std::string_view(piped.data(), piped.size()) == content);
+
+  TempCsv csv(content);
+  CsvReader file(csv.path());
+  piped.parse(',');
+  file.parse(',');
+  REQUIRE(piped.row_count() == file.row_count());
+  for (size_t r = 0; r < file.row_count(); ++r)
+    REQUIRE(piped.row(r)[2] == file.row(r)[2]);
+}
+
+TEST_CASE("parse_io_options: names map to flags", "[csv_reader]") {
+  IoOptions io = parse_io_options("sequential,populate,dropbehind,pread");
+  REQUIRE(io.sequential);
+  REQUIRE_FALSE(io.willneed);
+  REQUIRE(io.populate);
+  REQUIRE_FALSE(io.hugepages);
+  REQUIRE(io.drop_behind);
+  REQUIRE(io.pread);
+  REQUIRE_FALSE(parse_io_options("").pread);
+  REQUIRE_THROWS_AS(parse_io_options("sequential,bogus"), std::runtime_error);
+}
+
+TEST_CASE("CsvReader: every I/O backend sees the same bytes",
+          "[csv_reader]") {
+  std::string content = make_quoted_csv(3000);
+  TempCsv csv(content);
+  CsvReader plain(csv.path());
+  plain.parse(',');
+  CsvReader head(csv.path());
+  head.parse_head(',', 10);
+
+  for (const char *spec : {"sequential,willneed", "populate,hugepages",
+                           "dropbehind", "pread", "pread,populate"}) {
+    IoOptions io = parse_io_options(spec);
+    CsvReader reader(csv.path(), io);
+    REQUIRE(std::string_view(reader.data(), reader.size()) == content);
+    reader.parse_head(',', 10);
+    REQUIRE(reader.total_rows() == head.total_rows());
+
+    // Streamed with read-ahead when pread is set
+    CsvReader stream(csv.path(), 256, io);
+    size_t rows = 0;
+    do {
+      stream.parse_lazy(',');
+      for (size_t i = 0; i < stream.row_count(); ++i, ++rows)
+        REQUIRE(stream.row(i)[2] == plain.row(rows)[2]);
+    } while (stream.read_block());
+    REQUIRE(rows == plain.row_count());
+  }
+}
+
+TEST_CASE("CsvReader: appended shards read as one table", "[csv_reader]") {
+  TempCsv first(make_quoted_csv(1000));
+  TempCsv second(make_quoted_csv(500));
+  CsvReader a(first.path());
+  a.parse(',');
+  CsvReader b(second.path());
+  b.parse(',');
+
+  for (bool lazy : {false, true}) {
+    auto merged = std::make_unique<CsvReader>(first.path());
+    auto shard = std::make_unique<CsvReader>(second.path());
+    if (lazy) {
+      merged->parse_lazy(',', 2);
+      shard->parse_lazy(',', 2);
+    } else {
+      merged->parse(',', 2);
+      shard->parse(',', 2);
+    }
+    std::vector<std::unique_ptr<CsvReader>> shards;
+    shards.push_back(std::move(shard));
+    merged->append(std::move(shards));
+
+    REQUIRE(merged->row_count() == 1500);
+    REQUIRE(merged->total_rows() == a.total_rows() + b.total_rows());
+    REQUIRE(merged->input_size() == a.size() + b.size());
+    for (size_t i = 0; i < 1500; ++i) {
+      const CsvReader &src = i < 1000 ? a : b;
+      size_t r = i < 1000 ? i : i - 1000;
+      for (size_t c = 0; c < 4; ++c)
+        REQUIRE(merged->field(i, c) == src.field(r, c));
+    }
+  }
+
+  // Shards must be parsed the same way
+  CsvReader lazy(first.path());
+  lazy.parse_lazy(',');
+  std::vector<std::unique_ptr<CsvReader>> shards;
+  shards.push_back(std::make_unique<CsvReader>(second.path()));
+  shards.back()->parse(',');
+  REQUIRE_THROWS_AS(lazy.append(std::move(shards)), std::runtime_error);
+}
+
+TEST_CASE("CsvReader: parse_sample lands on real rows", "[csv_reader]") {
+  // Large enough for random offsets; quoted fields hold delimiters,
+  // newlines and "" escapes that the resync has to see through
+  TempCsv csv(make_quoted_csv(200000));
+  CsvReader full(csv.path());
+  full.parse(',');
+
+  CsvReader sample(csv.path());
+  sample.parse_sample(',', 500, 42);
+  REQUIRE(sample.row_count() == 500);
+  REQUIRE(sample.total_rows() == 500);
+  size_t prev = 0;
+  for (size_t i = 0; i < sample.row_count(); ++i) {
+    size_t id = std::stoul(std::string(sample.field(i, 0)));
+    REQUIRE((i == 0 || id > prev));
+    prev = id;
+    for (size_t c = 0; c < 4; ++c)
+      REQUIRE(sample.field(i, c) == full.field(id, c));
+  }
+
+  CsvReader again(csv.path());
+  again.parse_sample(',', 500, 42);
+  CsvReader other(csv.path());
+  other.parse_sample(',', 500, 43);
+  bool same = true, differs = false;
+  for (size_t i = 0; i < 500; ++i) {
+    same = same && again.field(i, 0) == sample.field(i, 0);
+    differs = differs || other.field(i, 0) != sample.field(i, 0);
+  }
+  REQUIRE(same);
+  REQUIRE(differs);
+}
+
+TEST_CASE("CsvReader: parse_sample draws rows by their own length",
+          "[csv_reader]") {
+  // The first row takes up about half the body: it is drawn nearly every
+  // time, and the short row after it no more often than any other
+  std::string csv = "id,note\n0," + std::string(3 << 20, 'x') + "\n";
+  for (int i = 1; i < 200000; ++i)
+    csv += std::to_string(i) + ",\"a, \"\"b\"\"\"\n";
+  TempCsv file(csv);
+
+  CsvReader reader(file.path());
+  reader.parse_sample(',', 20, 7);
+  REQUIRE(reader.row_count() == 20);
+  REQUIRE(reader.field(0, 0) == "0");
+  for (size_t i = 1; i < reader.row_count(); ++i) {
+    REQUIRE(reader.field(i, 0) != "1");
+    REQUIRE(reader.field(i, 1) == "\"a, \"\"b\"\"\"");
+  }
+}
+
+TEST_CASE("CsvReader: parse_sample of a small file is exact",
+          "[csv_reader]") {
+  TempCsv csv("a,b\n1,x\n\n2,\"y\nz\"\n3,w\n");
+  CsvReader reader(csv.path());
+  reader.parse_sample(',', 10, 1);
+  REQUIRE(reader.row_count() == 3);
+  REQUIRE(reader.field(0, 0) == "1");
+  REQUIRE(reader.field(1, 1) == "\"y\nz\"");
+  REQUIRE(reader.field(2, 0) == "3");
+
+  reader.parse_sample(',', 2, 1);
+  REQUIRE(reader.row_count() == 2);
+}
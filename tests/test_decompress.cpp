@@ -0,0 +1,335 @@
+#include <catch2/catch_test_macros.hpp>
+#include "include/csv_reader.hpp"
+#include "include/decompress.hpp"
+#include "include/sidecar.hpp"
+#include "test_helpers.hpp"
+#include <fcntl.h>
+#include <cstdio>
+#include <string>
+#include <unistd.h>
+
+#ifdef GLANCE_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef GLANCE_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+TEST_CASE("detect_compression: magic bytes", "[decompress]") {
+  REQUIRE(detect_compression("\x1f\x8b\x08\x00", 4) == Compression::Gzip);
+  REQUIRE(detect_compression("\x28\xb5\x2f\xfd", 4) == Compression::Zstd);
+  REQUIRE(detect_compression("a,b\n", 4) == Compression::None);
+  REQUIRE(detect_compression("\x28\xb5", 2) == Compression::None);
+  REQUIRE(detect_compression("", 0) == Compression::None);
+}
+
+#if defined(GLANCE_HAVE_ZLIB) || defined(GLANCE_HAVE_ZSTD)
+static std::string sample_csv(int rows = 2000) {
+  std::string csv = "id,name,note\n";
+  for (int i = 0; i < rows; ++i)
+    csv += std::to_string(i) + ",name" + std::to_string(i) +
+           ",\"two\nlines\"\n";
+  return csv;
+}
+#endif
+
+#ifdef GLANCE_HAVE_ZLIB
+static std::string gzip_member(const std::string &data) {
+  z_stream zs{};
+  REQUIRE(deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                       16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) == Z_OK);
+  std::string out(deflateBound(&zs, static_cast<uLong>(data.size())), '\0');
+  zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+  zs.avail_in = static_cast<uInt>(data.size());
+  zs.next_out = reinterpret_cast<Bytef *>(out.data());
+  zs.avail_out = static_cast<uInt>(out.size());
+  REQUIRE(deflate(&zs, Z_FINISH) == Z_STREAM_END);
+  out.resize(zs.total_out);
+  deflateEnd(&zs);
+  return out;
+}
+
+TEST_CASE("CsvReader: gzip file is decompressed transparently",
+          "[decompress]") {
+  std::string csv = sample_csv();
+  // Two members, as written by pigz or by concatenating .gz files
+  size_t half = csv.size() / 2;
+  TempCsv gz(gzip_member(csv.substr(0, half)) +
+             gzip_member(csv.substr(half)));
+
+  CsvReader reader(gz.path());
+  REQUIRE(std::string_view(reader.data(), reader.size()) == csv);
+  reader.parse(',');
+  REQUIRE(reader.row_count() == 2000);
+  REQUIRE(reader.field(1999, 1) == "name1999");
+}
+
+TEST_CASE("CsvReader: gzip stream is decompressed block by block",
+          "[decompress]") {
+  std::string csv = sample_csv();
+  TempCsv gz(gzip_member(csv));
+
+  int fd = open(gz.path(), O_RDONLY);
+  REQUIRE(fd >= 0);
+  CsvReader stream(fd, 512);
+  size_t rows = 0;
+  do {
+    stream.parse_lazy(',');
+    REQUIRE(stream.headers()[2] == "note");
+    for (size_t i = 0; i < stream.row_count(); ++i, ++rows)
+      REQUIRE(stream.field(i, 0) == std::to_string(rows));
+  } while (stream.read_block());
+  close(fd);
+  REQUIRE(rows == 2000);
+}
+
+TEST_CASE("CsvReader: truncated gzip input throws", "[decompress]") {
+  std::string member = gzip_member(sample_csv());
+  TempCsv gz(member.substr(0, member.size() / 2));
+  REQUIRE_THROWS_AS(CsvReader(gz.path()), std::runtime_error);
+}
+
+TEST_CASE("seek index: every point resumes mid-stream", "[decompress]") {
+  std::string csv = sample_csv(40000);
+  size_t half = csv.size() / 2;
+  TempCsv gz(gzip_member(csv.substr(0, half)) +
+             gzip_member(csv.substr(half)));
+
+  int fd = open(gz.path(), O_RDONLY);
+  REQUIRE(fd >= 0);
+  SeekIndex index = build_seek_index(fd, Compression::Gzip, 1 << 16);
+  REQUIRE(index.total_out == csv.size());
+  REQUIRE(index.points.size() > 4);
+  REQUIRE(index.points.front().out == 0);
+
+  for (auto &point : index.points) {
+    auto decoder = Decompressor::open_at(fd, Compression::Gzip, point);
+    std::string rest(csv.size() - point.out + 1, '\0');
+    size_t len = 0;
+    while (size_t n = decoder->read(rest.data() + len, rest.size() - len))
+      len += n;
+    rest.resize(len);
+    REQUIRE(rest == csv.substr(point.out));
+
+    size_t quotes = 0;
+    for (size_t i = 0; i < point.out; ++i)
+      quotes += csv[i] == '"';
+    REQUIRE(point.in_quotes == (quotes % 2 == 1));
+    bool row_start =
+        point.out == 0 || (!point.in_quotes && csv[point.out - 1] == '\n');
+    REQUIRE(point.row_start == row_start);
+  }
+  close(fd);
+}
+
+TEST_CASE("seek index: persisted and used for tail", "[decompress]") {
+  std::string csv = sample_csv(40000);
+  TempCsv gz(gzip_member(csv));
+  std::string path = gz.path();
+
+  int fd = open(path.c_str(), O_RDONLY);
+  REQUIRE(fd >= 0);
+  SeekIndex built = build_seek_index(fd, Compression::Gzip, 1 << 16);
+  close(fd);
+  write_seek_index(path, built);
+
+  SeekIndex index;
+  REQUIRE(load_seek_index(path, index));
+  REQUIRE(index.points.size() == built.points.size());
+  REQUIRE(index.points.back().window == built.points.back().window);
+
+  CsvReader whole(path.c_str());
+  for (size_t n : {size_t{0}, size_t{3}, size_t{5000}, size_t{40000}}) {
+    CsvReader tail(path.c_str(), index, n);
+    REQUIRE((tail.size() < whole.size() || n == 40000));
+    REQUIRE(tail.input_size() == whole.input_size());
+    tail.parse_tail(',', n);
+    whole.parse_tail(',', n);
+    REQUIRE(tail.headers() == whole.headers());
+    REQUIRE(tail.row_count() == whole.row_count());
+    for (size_t i = 0; i < tail.row_count(); ++i)
+      REQUIRE(tail.field(i, 0) == whole.field(i, 0));
+  }
+
+  // A seek index is rejected once the compressed file changes
+  TempCsv other(gzip_member(sample_csv(10)));
+  std::rename(sidecar_path(path).c_str(), sidecar_path(other.path()).c_str());
+  REQUIRE_FALSE(load_seek_index(other.path(), index));
+  std::remove(sidecar_path(other.path()).c_str());
+}
+#endif
+
+#ifdef GLANCE_HAVE_ZSTD
+static std::string zstd_frame(const std::string &data) {
+  std::string out(ZSTD_compressBound(data.size()), '\0');
+  size_t n = ZSTD_compress(out.data(), out.size(), data.data(), data.size(), 3);
+  REQUIRE_FALSE(ZSTD_isError(n));
+  out.resize(n);
+  return out;
+}
+
+// Frames of about frame_bytes each, split at arbitrary bytes
+static std::string zstd_frames(const std::string &data, size_t frame_bytes) {
+  std::string out;
+  for (size_t at = 0; at < data.size(); at += frame_bytes)
+    out += zstd_frame(data.substr(at, frame_bytes));
+  return out;
+}
+
+static void append_le32(std::string &out, uint32_t v) {
+  for (int i = 0; i < 4; ++i)
+    out += static_cast<char>(v >> (8 * i));
+}
+
+// The same frames in the seekable format: a closing skippable frame lists
+// each frame's sizes (here with checksums, which glance skips)
+static std::string zstd_seekable(const std::string &data, size_t frame_bytes) {
+  std::string frames, table;
+  uint32_t count = 0;
+  for (size_t at = 0; at < data.size(); at += frame_bytes, ++count) {
+    std::string chunk = data.substr(at, frame_bytes);
+    std::string frame = zstd_frame(chunk);
+    frames += frame;
+    append_le32(table, static_cast<uint32_t>(frame.size()));
+    append_le32(table, static_cast<uint32_t>(chunk.size()));
+    append_le32(table, 0);
+  }
+  append_le32(table, count);
+  table += static_cast<char>(0x80);
+  append_le32(table, 0x8F92EAB1);
+  std::string skippable;
+  append_le32(skippable, 0x184D2A5E);
+  append_le32(skippable, static_cast<uint32_t>(table.size()));
+  return frames + skippable + table;
+}
+
+TEST_CASE("CsvReader: zstd frames are decompressed transparently",
+          "[decompress]") {
+  std::string csv = sample_csv();
+  TempCsv zst(zstd_frames(csv, csv.size() / 3 + 1));
+
+  CsvReader reader(zst.path());
+  REQUIRE(std::string_view(reader.data(), reader.size()) == csv);
+  reader.parse(',');
+  REQUIRE(reader.row_count() == 2000);
+  REQUIRE(reader.field(1999, 1) == "name1999");
+}
+
+TEST_CASE("CsvReader: zstd stream is decompressed block by block",
+          "[decompress]") {
+  // One frame larger than a zstd block, read out through small blocks, so
+  // the decoder still holds output after the last input byte is consumed
+  std::string csv = sample_csv(20000);
+  TempCsv zst(zstd_frame(csv));
+
+  int fd = open(zst.path(), O_RDONLY);
+  REQUIRE(fd >= 0);
+  CsvReader stream(fd, 512);
+  size_t rows = 0;
+  do {
+    stream.parse_lazy(',');
+    REQUIRE(stream.headers()[2] == "note");
+    for (size_t i = 0; i < stream.row_count(); ++i, ++rows)
+      REQUIRE(stream.field(i, 0) == std::to_string(rows));
+  } while (stream.read_block());
+  close(fd);
+  REQUIRE(rows == 20000);
+}
+
+TEST_CASE("CsvReader: truncated zstd input throws", "[decompress]") {
+  std::string frame = zstd_frame(sample_csv());
+  TempCsv zst(frame.substr(0, frame.size() / 2));
+  REQUIRE_THROWS_AS(CsvReader(zst.path()), std::runtime_error);
+
+  int fd = open(zst.path(), O_RDONLY);
+  REQUIRE(fd >= 0);
+  REQUIRE_THROWS_AS(build_seek_index(fd, Compression::Zstd),
+                    std::runtime_error);
+  close(fd);
+}
+
+TEST_CASE("seek index: zstd points sit on frame ends", "[decompress]") {
+  std::string csv = sample_csv(40000);
+  TempCsv zst(zstd_frames(csv, 1 << 15));
+  std::string path = zst.path();
+
+  int fd = open(path.c_str(), O_RDONLY);
+  REQUIRE(fd >= 0);
+  SeekIndex index = build_seek_index(fd, Compression::Zstd, 1 << 16);
+  REQUIRE(index.total_out == csv.size());
+  REQUIRE(index.points.size() > 4);
+  REQUIRE(index.points.front().out == 0);
+
+  for (auto &point : index.points) {
+    REQUIRE(point.out % (1 << 15) == 0);
+    auto decoder = Decompressor::open_at(fd, Compression::Zstd, point);
+    std::string rest(csv.size() - point.out + 1, '\0');
+    size_t len = 0;
+    while (size_t n = decoder->read(rest.data() + len, rest.size() - len))
+      len += n;
+    rest.resize(len);
+    REQUIRE(rest == csv.substr(point.out));
+
+    size_t quotes = 0;
+    for (size_t i = 0; i < point.out; ++i)
+      quotes += csv[i] == '"';
+    REQUIRE(point.in_quotes == (quotes % 2 == 1));
+  }
+  close(fd);
+
+  write_seek_index(path, index);
+  SeekIndex loaded;
+  REQUIRE(load_seek_index(path, loaded));
+  CsvReader whole(path.c_str());
+  for (size_t n : {size_t{3}, size_t{5000}}) {
+    CsvReader tail(path.c_str(), loaded, n);
+    REQUIRE(tail.size() < whole.size());
+    tail.parse_tail(',', n);
+    whole.parse_tail(',', n);
+    REQUIRE(tail.row_count() == whole.row_count());
+    for (size_t i = 0; i < tail.row_count(); ++i)
+      REQUIRE(tail.field(i, 0) == whole.field(i, 0));
+  }
+  std::remove(sidecar_path(path).c_str());
+}
+
+TEST_CASE("seek index: zstd seek table gives the scanned points",
+          "[decompress]") {
+  std::string csv = sample_csv(40000);
+  TempCsv plain(zstd_frames(csv, 1 << 15));
+  TempCsv seekable(zstd_seekable(csv, 1 << 15));
+
+  int fd = open(plain.path(), O_RDONLY);
+  REQUIRE(fd >= 0);
+  SeekIndex scanned = build_seek_index(fd, Compression::Zstd, 1 << 16);
+  close(fd);
+
+  fd = open(seekable.path(), O_RDONLY);
+  REQUIRE(fd >= 0);
+  for (size_t threads : {size_t{1}, size_t{3}}) {
+    SeekIndex index =
+        build_seek_index(fd, Compression::Zstd, 1 << 16, threads);
+    REQUIRE(index.total_out == csv.size());
+    REQUIRE(index.points.size() == scanned.points.size());
+    for (size_t k = 0; k < index.points.size(); ++k) {
+      REQUIRE(index.points[k].out == scanned.points[k].out);
+      REQUIRE(index.points[k].in == scanned.points[k].in);
+      REQUIRE(index.points[k].in_quotes == scanned.points[k].in_quotes);
+      REQUIRE(index.points[k].row_start == scanned.points[k].row_start);
+    }
+  }
+
+  // The table frame is skipped when decoding, resumed or not
+  auto decoder = Decompressor::open_at(fd, Compression::Zstd,
+                                       scanned.points.back());
+  std::string rest(csv.size(), '\0');
+  size_t len = 0;
+  while (size_t n = decoder->read(rest.data() + len, rest.size() - len))
+    len += n;
+  rest.resize(len);
+  REQUIRE(rest == csv.substr(scanned.points.back().out));
+  close(fd);
+  CsvReader reader(seekable.path());
+  REQUIRE(std::string_view(reader.data(), reader.size()) == csv);
+}
+#endif
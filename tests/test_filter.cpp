@@ -46,6 +46,77 @@ TEST_CASE("parse_filter: starts_with and ends_with", "[filter]") {
   REQUIRE(f2.value == "e");
 }
 
+TEST_CASE("parse_filter: in list", "[filter]") {
+  auto f = parse_filter("dept in Eng, Sales ,,Ops");
+  REQUIRE(f.column == "dept");
+  REQUIRE(f.op == FilterOp::In);
+  REQUIRE(in_values(f) == std::vector<std::string>{"Eng", "Sales", "Ops"});
+
+  auto eq = parse_filter("note == sign in here");
+  REQUIRE(eq.op == FilterOp::Eq);
+  REQUIRE(eq.value == "sign in here");
+
+  auto col = parse_filter("time in ms > 4");
+  REQUIRE(col.column == "time in ms");
+  REQUIRE(col.op == FilterOp::Gt);
+  REQUIRE(col.value == "4");
+
+  REQUIRE_THROWS_AS(parse_filter("dept in ,"), std::runtime_error);
+}
+
+TEST_CASE("parse_filter_expr: precedence and grouping", "[filter]") {
+  using Kind = FilterExpr::Kind;
+  auto e = parse_filter_expr("a == 1 or b == 2 and not c == 3");
+  REQUIRE(e.kind == Kind::Or);
+  REQUIRE(e.operands.size() == 2);
+  REQUIRE(e.operands[0].filter.column == "a");
+  REQUIRE(e.operands[1].kind == Kind::And);
+  REQUIRE(e.operands[1].operands[1].kind == Kind::Not);
+  REQUIRE(e.operands[1].operands[1].operands[0].filter.value == "3");
+
+  auto g = parse_filter_expr("(a == 1 OR b == 2) AND c contains f(x)");
+  REQUIRE(g.kind == Kind::And);
+  REQUIRE(g.operands[0].kind == Kind::Or);
+  REQUIRE(g.operands[1].filter.value == "f(x)");
+  REQUIRE(expr_filters(g).size() == 3);
+
+  auto single = parse_filter_expr("name == Alice");
+  REQUIRE(single.kind == Kind::Compare);
+  REQUIRE(single.filter.value == "Alice");
+}
+
+TEST_CASE("parse_filter_expr: values containing keywords", "[filter]") {
+  auto e = parse_filter_expr("dept == R and D");
+  REQUIRE(e.kind == FilterExpr::Kind::Compare);
+  REQUIRE(e.filter.value == "R and D");
+  REQUIRE(parse_filter_expr("title contains war or peace").filter.value ==
+          "war or peace");
+  REQUIRE(parse_filter_expr("note == nothing").filter.value == "nothing");
+
+  auto quoted = parse_filter_expr("dept == \"R and D\" or salary > 94000");
+  REQUIRE(quoted.kind == FilterExpr::Kind::Or);
+  REQUIRE(quoted.operands[0].filter.value == "R and D");
+  REQUIRE(quoted.operands[1].filter.column == "salary");
+  REQUIRE(in_values(parse_filter("dept in \"R, D\", Eng")) ==
+          std::vector<std::string>{"R, D", "Eng"});
+  REQUIRE(in_values(parse_filter("dept in \"Eng\", \"Ops\"")) ==
+          std::vector<std::string>{"Eng", "Ops"});
+
+  // Comparisons around a part that is not one: no reading is safe
+  REQUIRE_THROWS(parse_filter_expr("dept == R and D or salary > 94000"));
+  REQUIRE_THROWS(parse_filter_expr("name and age > 3"));
+  REQUIRE_THROWS(parse_filter_expr("a > 1 and not b = w"));
+  REQUIRE_THROWS(parse_filter_expr("(a > 1) and b = w"));
+}
+
+TEST_CASE("parse_filter_expr: malformed expressions throw", "[filter]") {
+  REQUIRE_THROWS(parse_filter_expr(""));
+  REQUIRE_THROWS(parse_filter_expr("(a == 1"));
+  REQUIRE_THROWS(parse_filter_expr("a == 1 and"));
+  REQUIRE_THROWS(parse_filter_expr("(a == 1) b == 2"));
+  REQUIRE_THROWS(parse_filter_expr("not"));
+}
+
 TEST_CASE("parse_filter: empty expression throws", "[filter]") {
   REQUIRE_THROWS_AS(parse_filter(""), std::runtime_error);
   REQUIRE_THROWS_AS(parse_filter("   "), std::runtime_error);
@@ -90,6 +161,38 @@ TEST_CASE("apply_filters: case insensitive", "[filter]") {
   REQUIRE(result_ci[0] == 0);
 }
 
+TEST_CASE("apply_filters: case insensitive text operators", "[filter]") {
+  CsvReader reader(fixture_path("basic.csv").c_str());
+  reader.parse(',');
+  auto schema = infer_schema(reader);
+
+  auto count = [&](const char *expr, bool ci) {
+    std::vector<Filter> filters = {parse_filter(expr)};
+    return apply_filters(filters, reader, schema, ci).size();
+  };
+  REQUIRE(count("name starts_with A", true) == 1);
+  REQUIRE(count("name starts_with a", false) == 0);
+  REQUIRE(count("name ends_with NK", true) == 2);
+  REQUIRE(count("department contains GINEER", true) == 4);
+  REQUIRE(count("department contains GINEER", false) == 0);
+  // Orders as if both sides were lowercase: "bob" > "b" but "Bob" < "b"
+  REQUIRE(count("name > b", true) == 9);
+  REQUIRE(count("name > b", false) == 0);
+}
+
+TEST_CASE("apply_filters: numeric literals parse once per value",
+          "[filter]") {
+  CsvReader reader(fixture_path("basic.csv").c_str());
+  reader.parse(',');
+  auto schema = infer_schema(reader);
+
+  // In splits on commas, so its values cannot have separators
+  std::vector<Filter> in = {parse_filter("salary in $85000, 72000.50, n/a")};
+  REQUIRE(apply_filters(in, reader, schema) == std::vector<size_t>{0, 1});
+  std::vector<Filter> gte = {parse_filter("salary >= $100,000")};
+  REQUIRE(apply_filters(gte, reader, schema) == std::vector<size_t>{5, 7});
+}
+
 TEST_CASE("apply_filters: OR logic", "[filter]") {
   CsvReader reader(fixture_path("basic.csv").c_str());
   reader.parse(',');
@@ -108,6 +211,61 @@ TEST_CASE("apply_filters: OR logic", "[filter]") {
   REQUIRE(result_or.size() == 6);
 }
 
+TEST_CASE("apply_filters: in list", "[filter]") {
+  CsvReader reader(fixture_path("basic.csv").c_str());
+  reader.parse(',');
+  auto schema = infer_schema(reader);
+
+  std::vector<Filter> in = {parse_filter("department in Engineering, management")};
+  std::vector<Filter> either = {
+      {"department", FilterOp::Eq, "Engineering"},
+      {"department", FilterOp::Eq, "Management"},
+  };
+  REQUIRE(apply_filters(in, reader, schema, true) ==
+          apply_filters(either, reader, schema, false, true));
+  REQUIRE(apply_filters(in, reader, schema).size() == 4);
+}
+
+TEST_CASE("apply_filters: threads return the serial result", "[filter]") {
+  // Enough blocks of rows for four threads
+  std::string content = "id,name,score\n";
+  for (int i = 0; i < 70000; ++i)
+    content += std::to_string(i) + ",n" + std::to_string(i % 977) + "," +
+               std::to_string((i * 31) % 1000) + "\n";
+  TempCsv csv(content);
+  CsvReader reader(csv.path());
+  reader.parse(',');
+  auto schema = infer_schema(reader);
+
+  std::vector<Filter> filters = {parse_filter("name contains 7"),
+                                 parse_filter("score >= 500")};
+  for (bool or_logic : {false, true}) {
+    auto serial = apply_filters(filters, reader, schema, false, or_logic);
+    auto parallel = apply_filters(filters, reader, schema, false, or_logic,
+                                  nullptr, 4);
+    REQUIRE(!serial.empty());
+    REQUIRE(parallel == serial);
+  }
+}
+
+TEST_CASE("apply_filters: expressions in one pass", "[filter]") {
+  CsvReader reader(fixture_path("basic.csv").c_str());
+  reader.parse(',');
+  auto schema = infer_schema(reader);
+  auto rows = [&](const char *expr) {
+    return apply_filters(parse_filter_expr(expr), reader, schema);
+  };
+
+  REQUIRE(rows("(department == Engineering or department == Sales) and "
+               "salary > 90000") == std::vector<size_t>{2, 4, 7});
+  REQUIRE(rows("not (age < 30 or age > 35)") ==
+          std::vector<size_t>{0, 2, 4, 9});
+  REQUIRE(rows("not not name == Bob") == std::vector<size_t>{1});
+  // and binds tighter than or
+  REQUIRE(rows("name == Bob or name == Eve and active == true") ==
+          std::vector<size_t>{1});
+}
+
 TEST_CASE("apply_filters: unknown column throws", "[filter]") {
   CsvReader reader(fixture_path("basic.csv").c_str());
   reader.parse(',');
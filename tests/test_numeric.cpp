@@ -0,0 +1,75 @@
+#include <catch2/catch_test_macros.hpp>
+#include "include/csv_reader.hpp"
+#include "include/numeric.hpp"
+#include "test_helpers.hpp"
+#include <cmath>
+
+TEST_CASE("parse_number: currency, separators and signs", "[numeric]") {
+  double d = 0;
+  REQUIRE((parse_number("42", d) && d == 42.0));
+  REQUIRE((parse_number("  -3.5 ", d) && d == -3.5));
+  REQUIRE((parse_number("+1e3", d) && d == 1000.0));
+  REQUIRE((parse_number(".25", d) && d == 0.25));
+  REQUIRE((parse_number("$1,234.50", d) && d == 1234.5));
+  REQUIRE((parse_number("-$12", d) && d == -12.0));
+  REQUIRE((parse_number("$-12", d) && d == -12.0));
+  REQUIRE((parse_number("\xe2\x82\xac" "9,000", d) && d == 9000.0));
+  REQUIRE((parse_number("\xc2\xa3" "7", d) && d == 7.0));
+}
+
+TEST_CASE("parse_number: rejects what is not a whole number", "[numeric]") {
+  double d = 0;
+  for (const char *s : {"", " ", "$", "-", "--5", "+-5", "$+-5", "$$5",
+                        "-$-5", "12 kg",
+                        "1.5x", "0x10", "inf", "-nan", "e5", "1e400"})
+    REQUIRE_FALSE(parse_number(s, d));
+  REQUIRE_FALSE(parse_number(std::string(200, '1'), d));
+}
+
+TEST_CASE("parse_float64: digits only, like parse_number", "[numeric]") {
+  double d = 0;
+  REQUIRE((parse_float64("-0.5", d) && d == -0.5));
+  REQUIRE((parse_float64("+.5", d) && d == 0.5));
+  REQUIRE((parse_float64("2.5e-3", d) && d == 0.0025));
+  for (const char *s : {"", "+", "-", "+-1", "--1", "inf", "-inf", "+inf",
+                        "infinity", "INF", "nan", "-nan", "NaN", "0x10",
+                        " 1", "1 ", "e5", "1e400"})
+    REQUIRE_FALSE(parse_float64(s, d));
+}
+
+TEST_CASE("parse_currency_cents: same symbols and signs as parse_number",
+          "[numeric]") {
+  int64_t c = 0;
+  REQUIRE((parse_currency_cents("$1,234.5", c) && c == 123450));
+  REQUIRE((parse_currency_cents("-$5", c) && c == -500));
+  REQUIRE((parse_currency_cents("$-5", c) && c == -500));
+  REQUIRE((parse_currency_cents("\xc2\xa3" "5", c) && c == 500));
+  REQUIRE((parse_currency_cents("\xe2\x82\xac" "0.99", c) && c == 99));
+  REQUIRE((parse_currency_cents("7", c) && c == 700));
+  for (const char *s : {"", "$", "1.2,3", "1,2.3,4", "$\xa3 5", "+-5",
+                        "-$-5", "$$5", "1.234", "5 USD"})
+    REQUIRE_FALSE(parse_currency_cents(s, c));
+}
+
+TEST_CASE("parse_number_column: a value per row, NaN otherwise",
+          "[numeric]") {
+  TempCsv csv("id,price\n1,$5\n2,\"1,000\"\n3,n/a\n4,\n5,-2.5\n");
+  CsvReader reader(csv.path());
+  reader.parse(',');
+
+  auto all = parse_number_column(reader, 1);
+  REQUIRE(all.size() == 5);
+  REQUIRE(all[0] == 5.0);
+  REQUIRE(all[1] == 1000.0);
+  REQUIRE(std::isnan(all[2]));
+  REQUIRE(std::isnan(all[3]));
+  REQUIRE(all[4] == -2.5);
+
+  std::vector<size_t> rows = {1, 4};
+  auto some = parse_number_column(reader, 1, &rows);
+  REQUIRE(std::isnan(some[0]));
+  REQUIRE(some[1] == 1000.0);
+  REQUIRE(some[4] == -2.5);
+
+  REQUIRE(std::isnan(parse_number_column(reader, 7)[0]));
+}
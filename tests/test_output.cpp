@@ -85,3 +85,28 @@ TEST_CASE("render_schema_json: contains column types", "[output]") {
   REQUIRE(out.find("\"currency\"") != std::string::npos);
   REQUIRE(out.find("\"bool\"") != std::string::npos);
 }
+
+TEST_CASE("render_json: block output matches one-shot output", "[output]") {
+  CsvReader reader(fixture_path("basic.csv").c_str());
+  reader.parse(',');
+  auto schema = infer_schema(reader);
+  std::vector<size_t> first = {0, 1, 2};
+  std::vector<size_t> second = {3, 4};
+  std::vector<size_t> all = {0, 1, 2, 3, 4};
+
+  std::string one_shot;
+  {
+    CaptureStdout cap;
+    render_json(reader, schema, &all, nullptr, 10);
+    one_shot = cap.str();
+  }
+
+  CaptureStdout cap;
+  size_t written = 0;
+  render_json_begin();
+  render_json_rows(reader, schema, &first, nullptr, 10, written);
+  render_json_rows(reader, schema, &second, nullptr, 10 - written, written);
+  render_json_end(written);
+  REQUIRE(written == 5);
+  REQUIRE(cap.str() == one_shot);
+}
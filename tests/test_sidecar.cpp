@@ -0,0 +1,150 @@
+#include <catch2/catch_test_macros.hpp>
+#include "include/csv_reader.hpp"
+#include "include/sidecar.hpp"
+#include "include/type_inference.hpp"
+#include "test_helpers.hpp"
+#include <cstdio>
+#include <string>
+#include <sys/time.h>
+#include <unistd.h>
+
+struct SidecarCleanup {
+  std::string path;
+  ~SidecarCleanup() { std::remove(path.c_str()); }
+};
+
+TEST_CASE("sidecar: round-trips the row index, schema and stats",
+          "[sidecar]") {
+  TempCsv csv("id;name;note\n1;Alice;\"a;b\"\n\n2;\"Bob \"\"B\"\"\";\n"
+              "3;;\"multi\nline\"\n");
+  SidecarCleanup cleanup{sidecar_path(csv.path())};
+
+  CsvReader reader(csv.path());
+  reader.parse_lazy(';');
+  auto schema = infer_schema(reader);
+  write_sidecar(csv.path(), reader, ';', schema);
+
+  CsvReader reopened(csv.path());
+  SidecarIndex index;
+  REQUIRE(load_sidecar(csv.path(), reopened, index));
+  REQUIRE(index.delimiter == ';');
+  REQUIRE(index.schema.size() == 3);
+  for (size_t c = 0; c < schema.size(); ++c) {
+    REQUIRE(index.schema[c].name == schema[c].name);
+    REQUIRE(index.schema[c].type == schema[c].type);
+  }
+  REQUIRE(index.stats[0].nulls == 0);
+  REQUIRE(index.stats[1].nulls == 1);
+  REQUIRE(index.stats[1].max_width == 7); // Bob "B"
+  REQUIRE(index.stats[2].nulls == 1);
+  REQUIRE(index.stats[2].max_width == 10); // multi\nline
+  REQUIRE(index.stats[0].min == "1");
+  REQUIRE(index.stats[0].max == "3");
+  REQUIRE(index.stats[1].min == "Alice");
+  REQUIRE(index.stats[1].distinct == 2);
+
+  reopened.load_lazy(index.delimiter, index.rows);
+  REQUIRE(reopened.row_count() == reader.row_count());
+  REQUIRE(reopened.total_rows() == 3);
+  for (size_t r = 0; r < reader.row_count(); ++r)
+    for (size_t c = 0; c < reader.column_count(); ++c)
+      REQUIRE(reopened.field(r, c) == reader.field(r, c));
+}
+
+TEST_CASE("sidecar: missing or stale index is rejected", "[sidecar]") {
+  TempCsv csv("a,b\n1,2\n3,4\n");
+  SidecarCleanup cleanup{sidecar_path(csv.path())};
+
+  CsvReader reader(csv.path());
+  SidecarIndex index;
+  REQUIRE_FALSE(load_sidecar(csv.path(), reader, index));
+
+  reader.parse_lazy(',');
+  write_sidecar(csv.path(), reader, ',', infer_schema(reader));
+  REQUIRE(load_sidecar(csv.path(), reader, index));
+
+  // Same size and content, different mtime
+  struct timeval times[2] = {{1000000000, 0}, {1000000000, 0}};
+  REQUIRE(utimes(csv.path(), times) == 0);
+  CsvReader touched(csv.path());
+  REQUIRE_FALSE(load_sidecar(csv.path(), touched, index));
+}
+
+TEST_CASE("sidecar: rewritten header invalidates the index", "[sidecar]") {
+  TempCsv csv("a,b\n1,2\n");
+  SidecarCleanup cleanup{sidecar_path(csv.path())};
+  struct timeval times[2] = {{1000000000, 0}, {1000000000, 0}};
+  REQUIRE(utimes(csv.path(), times) == 0);
+  CsvReader reader(csv.path());
+  reader.parse_lazy(',');
+  write_sidecar(csv.path(), reader, ',', infer_schema(reader));
+
+  // Keep size and mtime, change the header bytes
+  FILE *f = std::fopen(csv.path(), "r+");
+  REQUIRE(f != nullptr);
+  std::fputs("x", f);
+  std::fclose(f);
+  REQUIRE(utimes(csv.path(), times) == 0);
+
+  CsvReader changed(csv.path());
+  SidecarIndex index;
+  REQUIRE_FALSE(load_sidecar(csv.path(), changed, index));
+}
+
+TEST_CASE("sidecar: write requires a lazy row index", "[sidecar]") {
+  TempCsv csv("a,b\n1,2\n");
+  CsvReader reader(csv.path());
+  reader.parse(',');
+  REQUIRE_THROWS_AS(write_sidecar(csv.path(), reader, ',', {}),
+                    std::runtime_error);
+}
+
+TEST_CASE("sidecar: packed rows with wide entries", "[sidecar]") {
+  TempCsv csv("a,b\n1,2\n\n3,4\n5,6\n");
+  CsvReader reader(csv.path());
+
+  // Row 1 is listed wide for its start, row 2 for its length
+  std::string lengths, advances, wide;
+  auto u32 = [](std::string &s, uint32_t v) {
+    s.append(reinterpret_cast<const char *>(&v), sizeof(v));
+  };
+  auto u64 = [](std::string &s, uint64_t v) {
+    s.append(reinterpret_cast<const char *>(&v), sizeof(v));
+  };
+  u32(lengths, 3);
+  u32(lengths, 3);
+  u32(lengths, PackedRows::kWide);
+  u32(advances, 4);
+  u32(advances, PackedRows::kWide);
+  u32(advances, 4);
+  for (uint64_t v : {1, 9, 3, 2, 13, 3})
+    u64(wide, v);
+  PackedRows rows{3, lengths.data(), advances.data(), 2, wide.data()};
+
+  reader.load_lazy(',', rows);
+  REQUIRE(reader.row_count() == 3);
+  REQUIRE(reader.field(0, 0) == "1");
+  REQUIRE(reader.field(1, 1) == "4");
+  REQUIRE(reader.field(2, 0) == "5");
+
+  // A row past the end of the file, or a wide list out of step, is
+  // rejected
+  std::string past = lengths;
+  past[4] = 50;
+  rows.lengths = past.data();
+  REQUIRE_THROWS_AS(reader.load_lazy(',', rows), std::runtime_error);
+  rows.lengths = lengths.data();
+  rows.wide_count = 1;
+  REQUIRE_THROWS_AS(reader.load_lazy(',', rows), std::runtime_error);
+}
+
+TEST_CASE("sidecar: truncated index is rejected", "[sidecar]") {
+  TempCsv csv("a,b\n1,2\n3,4\n");
+  SidecarCleanup cleanup{sidecar_path(csv.path())};
+  CsvReader reader(csv.path());
+  reader.parse_lazy(',');
+  write_sidecar(csv.path(), reader, ',', infer_schema(reader));
+  REQUIRE(truncate(cleanup.path.c_str(), 100) == 0);
+  SidecarIndex index;
+  REQUIRE_FALSE(load_sidecar(csv.path(), reader, index));
+}
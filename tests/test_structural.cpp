@@ -0,0 +1,198 @@
+#include <catch2/catch_test_macros.hpp>
+#include "include/csv_reader.hpp"
+#include "include/structural.hpp"
+#include "test_helpers.hpp"
+#include <random>
+#include <string>
+#include <vector>
+
+// Byte-at-a-time reference for the row/field state machine
+static std::vector<std::vector<std::string>>
+reference_parse(const std::string &s, char delim) {
+  std::vector<std::vector<std::string>> rows;
+  size_t total = s.size();
+  auto line_end = [&](size_t start) {
+    bool q = false;
+    for (size_t i = start; i < total; ++i) {
+      if (s[i] == '"')
+        q = !q;
+      else if (!q && s[i] == '\n')
+        return i;
+    }
+    return total;
+  };
+  auto tokenize = [&](size_t start, size_t end, size_t limit) {
+    std::vector<std::string> f;
+    size_t i = start;
+    while (i < end && f.size() < limit) {
+      size_t fs = i;
+      if (s[i] == '"') {
+        ++i;
+        while (i < end) {
+          if (s[i] == '"') {
+            if (i + 1 < end && s[i + 1] == '"')
+              i += 2;
+            else
+              break;
+          } else
+            ++i;
+        }
+        if (i < end)
+          ++i;
+        f.push_back(s.substr(fs, i - fs));
+        if (i < end && s[i] == delim)
+          ++i;
+      } else {
+        while (i < end && s[i] != delim)
+          ++i;
+        f.push_back(s.substr(fs, i - fs));
+        if (i < end)
+          ++i;
+      }
+    }
+    if (f.size() < limit && end > start && s[end - 1] == delim)
+      f.emplace_back();
+    return f;
+  };
+
+  size_t hdr_end = line_end(0);
+  size_t hdr_actual = hdr_end;
+  if (hdr_actual > 0 && s[hdr_actual - 1] == '\r')
+    --hdr_actual;
+  size_t ncols = tokenize(0, hdr_actual, SIZE_MAX).size();
+  size_t pos = (hdr_end < total) ? hdr_end + 1 : total;
+  while (pos < total) {
+    size_t le = line_end(pos);
+    size_t ae = le;
+    if (ae > pos && s[ae - 1] == '\r')
+      --ae;
+    if (ae > pos) {
+      auto f = tokenize(pos, ae, ncols);
+      f.resize(ncols);
+      rows.push_back(std::move(f));
+    }
+    pos = (le < total) ? le + 1 : total;
+  }
+  return rows;
+}
+
+static void require_matches_reference(const std::string &content,
+                                      size_t threads = 1) {
+  TempCsv csv(content);
+  auto expected = reference_parse(content, ',');
+
+  for (bool lazy : {false, true}) {
+    CsvReader reader(csv.path());
+    if (lazy)
+      reader.parse_lazy(',', threads);
+    else
+      reader.parse(',', threads);
+
+    REQUIRE(reader.row_count() == expected.size());
+    size_t mismatches = 0;
+    for (size_t r = 0; r < expected.size(); ++r) {
+      auto row = reader.row(r);
+      for (size_t c = 0; c < reader.column_count(); ++c)
+        if (row[c] != expected[r][c])
+          ++mismatches;
+    }
+    REQUIRE(mismatches == 0);
+  }
+}
+
+TEST_CASE("prefix_xor: computes inclusive parity", "[structural]") {
+  REQUIRE(prefix_xor(0) == 0);
+  REQUIRE(prefix_xor(1) == ~uint64_t{0});
+  // Quotes at bits 2 and 5 → bits 2..4 inside
+  REQUIRE(prefix_xor((uint64_t{1} << 2) | (uint64_t{1} << 5)) == 0x1C);
+}
+
+TEST_CASE("find_row_end: skips newlines inside quotes", "[structural]") {
+  std::string s = "a,\"x\ny\",b\nnext";
+  REQUIRE(find_row_end(s.data(), s.size(), 0) == 9);
+  REQUIRE(find_row_end(s.data(), s.size(), 0, true) == 4);
+
+  // Quote state carries across 64-byte blocks
+  std::string long_field = "\"" + std::string(100, 'x') + "\n" +
+                           std::string(30, 'y') + "\"\nrest";
+  REQUIRE(find_row_end(long_field.data(), long_field.size(), 0) ==
+          long_field.size() - 5);
+}
+
+TEST_CASE("count_row_ends: matches a byte-at-a-time count", "[structural]") {
+  std::mt19937 rng(7);
+  const char alphabet[] = {'a', '"', '\n', ','};
+  for (int round = 0; round < 200; ++round) {
+    std::string s;
+    size_t len = rng() % 300;
+    for (size_t i = 0; i < len; ++i)
+      s += alphabet[rng() % sizeof(alphabet)];
+
+    RowEndCount expected;
+    bool q = false;
+    for (char c : s) {
+      if (c == '"')
+        q = !q;
+      else if (c == '\n') {
+        ++expected.newlines;
+        if (!q)
+          ++expected.outside;
+      }
+    }
+    RowEndCount got = count_row_ends(s.data(), s.size());
+    REQUIRE(got.outside == expected.outside);
+    REQUIRE(got.newlines == expected.newlines);
+    REQUIRE(got.odd_quotes == q);
+
+    // A tail counted on its own combines with the head's quote parity
+    size_t cut = len ? rng() % len : 0;
+    RowEndCount head = count_row_ends(s.data(), cut);
+    RowEndCount rest = count_row_ends(s.data() + cut, len - cut);
+    size_t combined =
+        head.outside +
+        (head.odd_quotes ? rest.newlines - rest.outside : rest.outside);
+    REQUIRE(combined == expected.outside);
+  }
+}
+
+TEST_CASE("StructuralIndex: delimiters outside quotes only", "[structural]") {
+  std::string s = "a,\"b,c\",d\n";
+  StructuralIndex index;
+  index.build(s.data(), 0, s.size(), ',');
+  REQUIRE(index.positions() == std::vector<uint32_t>{1, 7, 9});
+  REQUIRE(index.clean(0, s.size()));
+}
+
+TEST_CASE("StructuralIndex: irregular quotes mark the block dirty",
+          "[structural]") {
+  std::string s = "ab\"c,d\n";
+  StructuralIndex index;
+  index.build(s.data(), 0, s.size(), ',');
+  REQUIRE_FALSE(index.clean(0, s.size()));
+}
+
+TEST_CASE("CsvReader: SIMD tokenizer matches reference on fixtures",
+          "[structural]") {
+  require_matches_reference("a,b,c\n1,\"x,y\",3\r\n\n4,,\n\"q\"\"q\",5,6\n");
+  require_matches_reference("a,b\n\"unterminated,1\n2,3\n");
+  require_matches_reference("a,b,c\n\"ab\"c,d,e\nx\"y,z\n");
+}
+
+TEST_CASE("CsvReader: SIMD tokenizer matches reference on random input",
+          "[structural]") {
+  std::mt19937 rng(42);
+  const char alphabet[] = {'a', 'b', ',', ',', '"', '\n', '\r', ' '};
+  for (int round = 0; round < 200; ++round) {
+    std::string content = "h1,h2,h3\n";
+    size_t len = 1 + rng() % 600;
+    for (size_t i = 0; i < len; ++i)
+      content += alphabet[rng() % sizeof(alphabet)];
+    require_matches_reference(content);
+  }
+}
+
+TEST_CASE("CsvReader: rows longer than the index window", "[structural]") {
+  std::string content = "id,text\n1,\"" + std::string(300000, 'x') +
+                        "\nmore\"\n2,short\n";
+  require_matches_reference(content);
+}
@@ -0,0 +1,60 @@
+#include <catch2/catch_test_macros.hpp>
+#include "include/text_search.hpp"
+#include <string>
+
+static std::string lowered(std::string s) {
+  for (char &c : s)
+    if (c >= 'A' && c <= 'Z')
+      c += 32;
+  return s;
+}
+
+TEST_CASE("TextMatcher: agrees with find on lowercased copies",
+          "[text_search]") {
+  // Haystacks long enough to cross several vector widths, with the needle
+  // at every offset and near misses around it
+  std::string base;
+  for (int i = 0; i < 100; ++i)
+    base += static_cast<char>("aBcXyZ-_09\xc3\xa9"[i % 12]);
+  for (const char *needle :
+       {"x", "Xy", "ZZ", "aBc", "c-_", "\xc3\xa9", "YZ-_09\xc3\xa9", "nope",
+        "Az-_09\xc3\xa9" "ABCx"}) {
+    TextMatcher ci(needle, true), cs(needle);
+    for (size_t len = 0; len <= base.size(); ++len) {
+      std::string hay = base.substr(0, len);
+      INFO(needle << " in " << len << " bytes");
+      REQUIRE(ci.find(hay) == lowered(hay).find(lowered(needle)));
+      REQUIRE(cs.find(hay) == hay.find(needle));
+    }
+  }
+}
+
+TEST_CASE("TextMatcher: prefixes, suffixes and equality", "[text_search]") {
+  TextMatcher m("Hello", true);
+  REQUIRE(m.needle() == "hello");
+  REQUIRE(m.starts_with("HELLO world"));
+  REQUIRE(m.ends_with("say hElLo"));
+  REQUIRE(m.equals("hello"));
+  REQUIRE_FALSE(m.equals("hello!"));
+  REQUIRE_FALSE(m.starts_with("Hell"));
+
+  TextMatcher exact("Hello");
+  REQUIRE_FALSE(exact.contains("say hello"));
+  REQUIRE(exact.contains("say Hello"));
+
+  TextMatcher empty("");
+  REQUIRE(empty.find("abc") == 0);
+  REQUIRE(empty.equals(""));
+}
+
+TEST_CASE("TextMatcher: folds only ASCII letters", "[text_search]") {
+  // 0xC3 and 0xE3 differ by the case bit but are not letters; nor are
+  // '@' and '`', or '[' and '{'
+  std::string wide(40, 'x');
+  wide += "\xe3@[";
+  TextMatcher m("\xc3`{", true);
+  REQUIRE_FALSE(m.contains(wide));
+  REQUIRE_FALSE(equal_folded("\xe3@[", "\xc3`{", 3));
+  REQUIRE(equal_folded("ABCDEFGHIJKLMNOPQRSTUVWXYZ[",
+                       "abcdefghijklmnopqrstuvwxyz[", 27));
+}
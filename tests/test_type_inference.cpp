@@ -100,3 +100,120 @@ TEST_CASE("infer_schema: empty column is text", "[type_inference]") {
   auto schema = infer_schema(reader);
   REQUIRE(schema[0].type == ColumnType::Text);
 }
+
+TEST_CASE("infer_schema: samples past the parsed head", "[type_inference]") {
+  // Integers until three quarters of the way in, then decimals
+  std::string content = "id,val,note\n";
+  for (int i = 0; i < 200000; ++i)
+    content += std::to_string(i) + "," +
+               (i < 150000 ? std::to_string(i % 97)
+                           : std::to_string(i % 97) + ".5") +
+               ",\"x, \"\"y\"\"\nz\"\n";
+  TempCsv csv(content);
+  CsvReader reader(csv.path());
+  reader.parse_head(',', 100);
+
+  auto spread = infer_schema(reader);
+  REQUIRE(spread[0].type == ColumnType::Int64);
+  REQUIRE(spread[1].type == ColumnType::Float64);
+  REQUIRE(spread[2].type == ColumnType::Enum);
+
+  // A budget no larger than the head sees only the head
+  auto head = infer_schema(reader, kInferenceHeadRows);
+  REQUIRE(head[1].type == ColumnType::Int64);
+}
+
+TEST_CASE("infer_schema: samples every appended shard", "[type_inference]") {
+  // Integers and dates in the first file; text in the same columns of the
+  // second
+  std::string ints = "id,val,day\n", text = "id,val,day\n";
+  for (int i = 0; i < 20000; ++i) {
+    ints += std::to_string(i) + "," + std::to_string(i % 97) +
+            ",2024-01-15\n";
+    text += std::to_string(i) + ",n/a " + std::to_string(i) + ",day " +
+            std::to_string(i) + "\n";
+  }
+  TempCsv first(ints), second(text);
+  CsvReader reader(first.path());
+  reader.parse_lazy(',');
+  std::vector<std::unique_ptr<CsvReader>> shards;
+  shards.push_back(std::make_unique<CsvReader>(second.path()));
+  shards.back()->parse_lazy(',');
+  reader.append(std::move(shards));
+
+  auto schema = infer_schema(reader);
+  REQUIRE(schema[0].type == ColumnType::Int64);
+  REQUIRE(schema[1].type == ColumnType::Text);
+  REQUIRE(schema[2].type == ColumnType::Text);
+}
+
+TEST_CASE("infer_schema_exact: agrees with sampling on the fixtures",
+          "[type_inference]") {
+  for (const char *name : {"basic.csv", "quoted.csv", "edge_cases.csv",
+                           "large.csv", "semicolons.csv", "tabs.tsv"}) {
+    CsvReader reader(fixture_path(name).c_str());
+    reader.parse(detect_delimiter(reader.data(), reader.size()));
+    auto sampled = infer_schema(reader);
+    auto exact = infer_schema_exact(reader, 4);
+    REQUIRE(exact.size() == sampled.size());
+    for (size_t i = 0; i < exact.size(); ++i) {
+      REQUIRE(exact[i].name == sampled[i].name);
+      REQUIRE(exact[i].type == sampled[i].type);
+    }
+  }
+}
+
+TEST_CASE("infer_schema_exact: checks every row", "[type_inference]") {
+  // One outlier per column, each on a single row; status is untyped only
+  // late, so its early values are collected after the fact
+  std::string content = "id,val,status,price\n";
+  for (int i = 0; i < 200000; ++i) {
+    content += (i == 123457 ? "x" : std::to_string(i)) + ",";
+    content += std::to_string(i % 97) + (i == 199999 ? ".5," : ",");
+    content += i < 180000 ? std::to_string(i % 3) : "\"n/a\"";
+    content += i == 777 ? ",\"$1,234.50\"\n" : ",$" + std::to_string(i) + "\n";
+  }
+  TempCsv csv(content);
+  CsvReader reader(csv.path());
+  reader.parse_lazy(',');
+
+  for (size_t threads : {1, 4}) {
+    auto schema = infer_schema_exact(reader, threads);
+    REQUIRE(schema[0].type == ColumnType::Text);
+    REQUIRE(schema[1].type == ColumnType::Float64);
+    REQUIRE(schema[2].type == ColumnType::Enum);
+    REQUIRE(schema[3].type == ColumnType::Currency);
+  }
+}
+
+TEST_CASE("infer_schema_exact: long values", "[type_inference]") {
+  // Sixteen bytes and more are classified a vector at a time
+  TempCsv csv("big,sci,tail\n"
+              "1234567890123456789,1.2345678901234567e10,12345678901234567\n"
+              "-123456789012345678,12345678901234567.25,1234567890123456%\n");
+  CsvReader reader(csv.path());
+  reader.parse(',');
+  auto schema = infer_schema_exact(reader);
+  REQUIRE(schema[0].type == ColumnType::Int64);
+  REQUIRE(schema[1].type == ColumnType::Float64);
+  REQUIRE(schema[2].type == ColumnType::Text);
+}
+
+TEST_CASE("SchemaTally: accumulates across readers", "[type_inference]") {
+  TempCsv ints("n,flag\n1,yes\n2,no\n");
+  TempCsv floats("n,flag\n2.5,maybe\n");
+  CsvReader a(ints.path()), b(floats.path());
+  a.parse(',');
+  b.parse(',');
+
+  SchemaTally tally;
+  tally.add(a);
+  REQUIRE(tally.schema()[0].type == ColumnType::Int64);
+  REQUIRE(tally.schema()[1].type == ColumnType::Bool);
+  tally.add(b);
+  auto schema = tally.schema();
+  REQUIRE(schema[0].name == "n");
+  REQUIRE(schema[0].type == ColumnType::Float64);
+  // Values of the first reader are gone by the time flag turns untyped
+  REQUIRE(schema[1].type == ColumnType::Text);
+}